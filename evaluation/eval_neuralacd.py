@@ -9,7 +9,6 @@ import sys
 import os
 import tempfile
 import argparse
-import multiprocessing as mp
 import open3d as o3d
 
 import lib_neural_acd
@@ -40,6 +39,24 @@ def process_sample(points, structure):
         return concavity, num_parts
 
 
+def make_lib_mesh(structure):
+    mesh = lib_neural_acd.Mesh()
+    mesh.vertices = lib_neural_acd.VecArray3d(structure[0])
+    mesh.triangles = lib_neural_acd.make_vecarray3i(structure[1])
+    return mesh
+
+
+def process_batch(cut_points, structures):
+    meshes = lib_neural_acd.MeshList([make_lib_mesh(st) for st in structures])
+    cut_points = [lib_neural_acd.VecArray3d(p.tolist()) for p in cut_points]
+    results = []
+    for res in lib_neural_acd.process_batch(meshes, cut_points):
+        if res.status != lib_neural_acd.ProcessStatus.OK:
+            raise RuntimeError(f"process_batch failed: {res.status} {res.error}")
+        results.append((res.result.concavity, len(res.result.cvxs)))
+    return results
+
+
 def evaluate(checkpoint, config, num_samples, num_workers=1, is_vhacd=False):
     points = []
     structures = []
@@ -86,8 +103,8 @@ def evaluate(checkpoint, config, num_samples, num_workers=1, is_vhacd=False):
     # exit()
 
     if num_workers > 1:
-        with mp.Pool(num_workers) as pool:
-            results = pool.starmap(process_sample, zip(cut_points, structures))
+        lib_neural_acd.config.num_threads = num_workers
+        results = process_batch(cut_points, structures)
     else:
         results = []
         for p, st in zip(cut_points, structures):
@@ -2,8 +2,10 @@
 #include <config.hpp>
 #include <core.hpp>
 #include <generate.hpp>
+#include <jlinkage.hpp>
 #include <preprocess.hpp>
 #include <process.hpp>
+#include <pybind11/functional.h>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -30,6 +32,107 @@ PYBIND11_MODULE(lib_neural_acd, m) {
 
   py::bind_vector<neural_acd::MeshList>(m, "MeshList");
 
+  py::class_<neural_acd::Plane>(m, "Plane")
+      .def(py::init<>())
+      .def(py::init<double, double, double, double>(), py::arg("a"),
+           py::arg("b"), py::arg("c"), py::arg("d"))
+      .def_readwrite("a", &neural_acd::Plane::a)
+      .def_readwrite("b", &neural_acd::Plane::b)
+      .def_readwrite("c", &neural_acd::Plane::c)
+      .def_readwrite("d", &neural_acd::Plane::d);
+
+  py::class_<neural_acd::PartAdjacency>(m, "PartAdjacency")
+      .def(py::init<>())
+      .def_readwrite("part1", &neural_acd::PartAdjacency::part1)
+      .def_readwrite("part2", &neural_acd::PartAdjacency::part2)
+      .def_readwrite("plane_id", &neural_acd::PartAdjacency::plane_id)
+      .def_readwrite("plane", &neural_acd::PartAdjacency::plane)
+      .def_readwrite("area", &neural_acd::PartAdjacency::area);
+
+  py::class_<neural_acd::StageStats>(m, "StageStats")
+      .def(py::init<>())
+      .def_readwrite("name", &neural_acd::StageStats::name)
+      .def_readwrite("wall_time", &neural_acd::StageStats::wall_time)
+      .def_readwrite("cpu_time", &neural_acd::StageStats::cpu_time)
+      .def_readwrite("items", &neural_acd::StageStats::items)
+      .def_readwrite("truncated", &neural_acd::StageStats::truncated);
+
+  py::class_<neural_acd::Metrics>(m, "Metrics")
+      .def(py::init<>())
+      .def_readwrite("input_vertices", &neural_acd::Metrics::input_vertices)
+      .def_readwrite("input_triangles", &neural_acd::Metrics::input_triangles)
+      .def_readwrite("cut_points", &neural_acd::Metrics::cut_points)
+      .def_readwrite("planes", &neural_acd::Metrics::planes)
+      .def_readwrite("clip_calls", &neural_acd::Metrics::clip_calls)
+      .def_readwrite("clips_skipped", &neural_acd::Metrics::clips_skipped)
+      .def_readwrite("cdt_failures", &neural_acd::Metrics::cdt_failures)
+      .def_readwrite("vch_fallbacks", &neural_acd::Metrics::vch_fallbacks)
+      .def_readwrite("merge_iterations",
+                     &neural_acd::Metrics::merge_iterations)
+      .def_readwrite("peak_parts", &neural_acd::Metrics::peak_parts)
+      .def_readwrite("output_hulls", &neural_acd::Metrics::output_hulls)
+      .def_readwrite("max_hull_vertices",
+                     &neural_acd::Metrics::max_hull_vertices)
+      .def_readwrite("hulls_over_vertex_limit",
+                     &neural_acd::Metrics::hulls_over_vertex_limit)
+      .def_readwrite("budget_stops", &neural_acd::Metrics::budget_stops);
+
+  py::class_<neural_acd::MergeStep>(m, "MergeStep")
+      .def(py::init<>())
+      .def_readwrite("node1", &neural_acd::MergeStep::node1)
+      .def_readwrite("node2", &neural_acd::MergeStep::node2)
+      .def_readwrite("cost", &neural_acd::MergeStep::cost)
+      .def_readwrite("forced", &neural_acd::MergeStep::forced);
+
+  py::class_<neural_acd::MergeTree>(m, "MergeTree")
+      .def(py::init<>())
+      .def_readwrite("num_leaves", &neural_acd::MergeTree::num_leaves)
+      .def_readwrite("nodes", &neural_acd::MergeTree::nodes)
+      .def_readwrite("steps", &neural_acd::MergeTree::steps)
+      .def("num_steps", &neural_acd::MergeTree::num_steps,
+           py::arg("threshold"), py::arg("max_parts") = 0)
+      .def("slice", &neural_acd::MergeTree::slice, py::arg("num_steps"))
+      .def("slice_threshold", &neural_acd::MergeTree::slice_threshold,
+           "The hulls merge_hulls would give at threshold. Pairs found by "
+           "distance, which are all of them with config.merge_part_graph "
+           "off, are those closer than the threshold the tree was recorded "
+           "with, so below it the result can differ from merge_hulls.",
+           py::arg("threshold"))
+      .def("slice_parts", &neural_acd::MergeTree::slice_parts,
+           py::arg("num_parts"))
+      .def("max_cost", &neural_acd::MergeTree::max_cost,
+           py::arg("num_steps"));
+
+  py::class_<neural_acd::ProcessResult>(m, "ProcessResult")
+      .def(py::init<>())
+      .def_readwrite("parts", &neural_acd::ProcessResult::parts)
+      .def_readwrite("cvxs", &neural_acd::ProcessResult::cvxs)
+      .def_readwrite("concavity", &neural_acd::ProcessResult::concavity)
+      .def_readwrite("stages", &neural_acd::ProcessResult::stages)
+      .def_readwrite("metrics", &neural_acd::ProcessResult::metrics)
+      .def_readwrite("merge_tree", &neural_acd::ProcessResult::merge_tree)
+      .def_readwrite("truncated", &neural_acd::ProcessResult::truncated);
+
+  py::enum_<neural_acd::ProcessStatus>(m, "ProcessStatus")
+      .value("OK", neural_acd::PROCESS_OK)
+      .value("EMPTY_MESH", neural_acd::PROCESS_EMPTY_MESH)
+      .value("FAILED", neural_acd::PROCESS_FAILED);
+
+  py::class_<neural_acd::BatchResult>(m, "BatchResult")
+      .def(py::init<>())
+      .def_readwrite("status", &neural_acd::BatchResult::status)
+      .def_readwrite("error", &neural_acd::BatchResult::error)
+      .def_readwrite("result", &neural_acd::BatchResult::result);
+
+  py::enum_<neural_acd::ConcavityMode>(m, "ConcavityMode")
+      .value("NONE", neural_acd::CONCAVITY_NONE)
+      .value("FAST", neural_acd::CONCAVITY_FAST)
+      .value("FULL", neural_acd::CONCAVITY_FULL);
+
+  py::enum_<neural_acd::PlaneFitMode>(m, "PlaneFitMode")
+      .value("JLINKAGE", neural_acd::PLANE_FIT_JLINKAGE)
+      .value("RANSAC", neural_acd::PLANE_FIT_RANSAC);
+
   py::class_<neural_acd::Config>(m, "Config")
       .def(py::init<>())
       .def_readwrite("generation_cuboid_width_min",
@@ -47,6 +150,15 @@ PYBIND11_MODULE(lib_neural_acd, m) {
       .def_readwrite("remesh_threshold", &neural_acd::Config::remesh_threshold)
       .def_readwrite("cost_rv_k", &neural_acd::Config::cost_rv_k)
       .def_readwrite("merge_threshold", &neural_acd::Config::merge_threshold)
+      .def_readwrite("merge_part_graph", &neural_acd::Config::merge_part_graph)
+      .def_readwrite("merge_cache_size", &neural_acd::Config::merge_cache_size)
+      .def_readwrite("max_parts", &neural_acd::Config::max_parts)
+      .def_readwrite("merge_record_tree",
+                     &neural_acd::Config::merge_record_tree)
+      .def_readwrite("max_ch_vertex", &neural_acd::Config::max_ch_vertex)
+      .def_readwrite("ch_volume_increase",
+                     &neural_acd::Config::ch_volume_increase)
+      .def_readwrite("plane_fit", &neural_acd::Config::plane_fit)
       .def_readwrite("jlinkage_sigma", &neural_acd::Config::jlinkage_sigma)
       .def_readwrite("jlinkage_num_samples",
                      &neural_acd::Config::jlinkage_num_samples)
@@ -54,8 +166,29 @@ PYBIND11_MODULE(lib_neural_acd, m) {
                      &neural_acd::Config::jlinkage_threshold)
       .def_readwrite("jlinkage_outlier_threshold",
                      &neural_acd::Config::jlinkage_outlier_threshold)
+      .def_readwrite("jlinkage_voxel_ratio",
+                     &neural_acd::Config::jlinkage_voxel_ratio)
+      .def_readwrite("jlinkage_partition_ratio",
+                     &neural_acd::Config::jlinkage_partition_ratio)
+      .def_readwrite("jlinkage_lsh_bands",
+                     &neural_acd::Config::jlinkage_lsh_bands)
+      .def_readwrite("jlinkage_lsh_rows",
+                     &neural_acd::Config::jlinkage_lsh_rows)
+      .def_readwrite("ransac_max_iterations",
+                     &neural_acd::Config::ransac_max_iterations)
+      .def_readwrite("ransac_normal_angle",
+                     &neural_acd::Config::ransac_normal_angle)
+      .def_readwrite("ransac_neighbours",
+                     &neural_acd::Config::ransac_neighbours)
+      .def_readwrite("refine_threshold", &neural_acd::Config::refine_threshold)
+      .def_readwrite("refine_depth", &neural_acd::Config::refine_depth)
       .def_readwrite("process_output_parts",
-                     &neural_acd::Config::process_output_parts);
+                     &neural_acd::Config::process_output_parts)
+      .def_readwrite("process_concavity",
+                     &neural_acd::Config::process_concavity)
+      .def_readwrite("process_time_budget",
+                     &neural_acd::Config::process_time_budget)
+      .def_readwrite("num_threads", &neural_acd::Config::num_threads);
 
   m.def("make_vecarray3i", [](py::array_t<int> input) {
     auto buf = input.request();
@@ -83,11 +216,110 @@ PYBIND11_MODULE(lib_neural_acd, m) {
   m.def("generate_sphere_structure", &neural_acd::generate_sphere_structure,
         py::arg("obj_num"));
   m.def("set_seed", &neural_acd::set_seed, py::arg("seed"));
+  m.def("decomposition_hash", &neural_acd::decomposition_hash,
+        py::arg("meshes"));
   m.def("clip", &neural_acd::clip, py::arg("mesh"), py::arg("plane_args"));
-  m.def("multiclip", &neural_acd::multiclip, py::arg("mesh"),
+  m.def("multiclip",
+        py::overload_cast<const neural_acd::Mesh,
+                          const std::vector<neural_acd::Plane> &>(
+            &neural_acd::multiclip),
+        py::arg("mesh"),
         py::arg("planes"));
   m.def("process", &neural_acd::process, py::arg("mesh"), py::arg("cut_points"),
         py::arg("stats_file") = "");
+  m.def("process_timed", &neural_acd::process_timed, py::arg("mesh"),
+        py::arg("cut_points"), py::arg("stats_file") = "",
+        py::arg("metrics_file") = "");
+  m.def("write_metrics", &neural_acd::write_metrics, py::arg("metrics_file"),
+        py::arg("result"));
+  m.def("process_stream", &neural_acd::process_stream,
+        "Passes every final hull to callback instead of returning it. With "
+        "config.process_concavity FULL every hull is still kept for the "
+        "concavity check, so memory is only saved with FAST or NONE.",
+        py::arg("mesh"), py::arg("cut_points"), py::arg("callback"),
+        py::arg("stats_file") = "", py::arg("metrics_file") = "");
+  m.def(
+      "process_to_directory",
+      [](neural_acd::Mesh mesh, std::vector<neural_acd::Vec3D> cut_points,
+         std::string directory, std::string stats_file,
+         std::string metrics_file) {
+        return neural_acd::process_stream(mesh, cut_points,
+                                          neural_acd::obj_writer(directory),
+                                          stats_file, metrics_file);
+      },
+      "Writes every final hull to directory/hull_<n>.obj as process_stream "
+      "does, with the same memory caveat.",
+      py::arg("mesh"), py::arg("cut_points"), py::arg("directory"),
+      py::arg("stats_file") = "", py::arg("metrics_file") = "",
+      py::call_guard<py::gil_scoped_release>());
+  m.def("process_batch", &neural_acd::process_batch, py::arg("meshes"),
+        py::arg("cut_points"), py::arg("stats_file") = "",
+        py::arg("metrics_file") = "",
+        py::call_guard<py::gil_scoped_release>());
+
+  // pipeline stages; the part graph is converted by value, so stages that
+  // update it return the new graph
+  m.def("normalize_input", &neural_acd::normalize_input, py::arg("mesh"),
+        py::arg("cut_points"));
+  m.def("fit_planes", &neural_acd::fit_planes, py::arg("cut_points"));
+
+  // plane fitting kept around for threshold sweeps
+  py::class_<neural_acd::JLinkage>(m, "JLinkage")
+      .def(py::init<double, int, double, int, double, int, int>(),
+           py::arg("sigma") = 1.0, py::arg("num_samples") = 10000,
+           py::arg("threshold") = 0.1, py::arg("outlier_threshold") = 10,
+           py::arg("voxel_size") = 0.0, py::arg("lsh_bands") = 0,
+           py::arg("lsh_rows") = 4)
+      .def("set_points", &neural_acd::JLinkage::set_points, py::arg("points"))
+      .def("get_best_planes", &neural_acd::JLinkage::get_best_planes)
+      .def("set_threshold", &neural_acd::JLinkage::set_threshold,
+           py::arg("threshold"))
+      .def("set_outlier_threshold",
+           &neural_acd::JLinkage::set_outlier_threshold,
+           py::arg("outlier_threshold"))
+      .def("get_clusters", &neural_acd::JLinkage::get_clusters);
+  m.def(
+      "multiclip_graph",
+      [](const neural_acd::Mesh &mesh,
+         const std::vector<neural_acd::Plane> &planes) {
+        neural_acd::PartGraph graph;
+        neural_acd::MeshList parts = neural_acd::multiclip(mesh, planes, graph);
+        return py::make_tuple(parts, graph);
+      },
+      py::arg("mesh"), py::arg("planes"));
+  m.def(
+      "separate_disjoint",
+      [](neural_acd::MeshList &parts, neural_acd::PartGraph graph) {
+        neural_acd::separate_disjoint(parts, graph);
+        return graph;
+      },
+      py::arg("parts"), py::arg("graph") = neural_acd::PartGraph());
+  m.def("compute_hulls", &neural_acd::compute_hulls, py::arg("parts"));
+  m.def(
+      "refine_parts",
+      [](neural_acd::MeshList &parts, neural_acd::MeshList &cvxs,
+         neural_acd::PartGraph graph,
+         const std::vector<neural_acd::Vec3D> &cut_points) {
+        neural_acd::refine_parts(parts, cvxs, graph, cut_points);
+        return graph;
+      },
+      py::arg("parts"), py::arg("cvxs"), py::arg("graph"),
+      py::arg("cut_points"));
+  m.def("compute_part_concavity", &neural_acd::compute_part_concavity,
+        py::arg("parts"), py::arg("cvxs"));
+  m.def("merge_hulls", &neural_acd::merge_hulls, py::arg("cvxs"),
+        py::arg("graph") = neural_acd::PartGraph());
+  m.def("record_merge_tree", &neural_acd::record_merge_tree,
+        "Merges copies of cvxs down to one hull, recording every step. "
+        "Merge candidates found by distance stay those closer than "
+        "config.merge_threshold at recording time; with "
+        "config.merge_part_graph off, slices at lower thresholds can differ "
+        "from merge_hulls.",
+        py::arg("cvxs"), py::arg("graph") = neural_acd::PartGraph());
+  m.def("simplify_hulls", &neural_acd::simplify_hulls, py::arg("cvxs"));
+  m.def("remesh_hulls", &neural_acd::remesh_hulls, py::arg("cvxs"));
+  m.def("compute_concavity", &neural_acd::compute_concavity, py::arg("mesh"),
+        py::arg("hull"));
   m.def("preprocess", &neural_acd::manifold_preprocess, py::arg("mesh"),
         py::arg("scale"), py::arg("level_set"));
 }
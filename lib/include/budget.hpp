@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <metrics.hpp>
+
+namespace neural_acd {
+
+// Wall-clock limit of a run
+class Deadline {
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit Deadline(double seconds)
+      : end(clock::now() + std::chrono::duration_cast<clock::duration>(
+                               std::chrono::duration<double>(seconds))) {}
+
+  bool passed() const { return clock::now() >= end; }
+
+  // deadline after the given fraction of the time left
+  Deadline share(double fraction) const {
+    Deadline d = *this;
+    clock::time_point now = clock::now();
+    if (now < end)
+      d.end = now + std::chrono::duration_cast<clock::duration>(
+                        (end - now) * fraction);
+    return d;
+  }
+
+private:
+  clock::time_point end;
+};
+
+// deadline of the run in progress, handed on to workers by parallel_for
+inline thread_local const Deadline *current_deadline = nullptr;
+
+// Stages call this where they can stop early and keep what they have so far.
+// Every stop is counted, which is how a stage is marked as truncated.
+inline bool out_of_time() {
+  if (!current_deadline || !current_deadline->passed())
+    return false;
+  count_event(&MetricsCounters::budget_stops);
+  return true;
+}
+
+// makes deadline (may be null) the current deadline of this thread until
+// destroyed
+class DeadlineScope {
+public:
+  explicit DeadlineScope(const Deadline *deadline) : prev(current_deadline) {
+    current_deadline = deadline;
+  }
+  ~DeadlineScope() { current_deadline = prev; }
+  DeadlineScope(const DeadlineScope &) = delete;
+  DeadlineScope &operator=(const DeadlineScope &) = delete;
+
+private:
+  const Deadline *prev;
+};
+
+} // namespace neural_acd
\ No newline at end of file
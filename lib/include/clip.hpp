@@ -6,8 +6,36 @@
 
 namespace neural_acd {
 
+// Two parts that touch across the cap of a cut plane
+struct PartAdjacency {
+  int part1, part2;
+  int plane_id; // index of the cut plane in the planes passed to multiclip
+  Plane plane;
+  double area; // area of the shared cap
+};
+using PartGraph = std::vector<PartAdjacency>;
+
+// Surface of a part lying in a cut plane
+struct PlaneContact {
+  bool touches = false;
+  double area = 0.0;
+  Vec3D min = {INF, INF, INF}, max = {-INF, -INF, -INF};
+};
+
 MeshList clip(const Mesh mesh, Plane plane);
 MeshList multiclip(const Mesh mesh, const std::vector<Plane> &planes);
+MeshList multiclip(const Mesh mesh, const std::vector<Plane> &planes,
+                   PartGraph &graph);
+
+PlaneContact plane_contact(const Mesh &mesh, Plane plane, double eps = 1e-6);
+bool contacts_overlap(const PlaneContact &c1, const PlaneContact &c2,
+                      double eps = 1e-4);
+// children[i] lists the indices in new_parts of the pieces old part i was
+// split into. Edges between two parts left whole are kept as they are, and
+// contacts are only measured again for split parts.
+PartGraph remap_part_graph(const PartGraph &graph,
+                           const std::vector<std::vector<int>> &children,
+                           const MeshList &new_parts);
 
 inline bool same_point_detect(Vec3D p0, Vec3D p1, float eps = 1e-5) {
   double dx, dy, dz;
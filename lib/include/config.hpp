@@ -1,6 +1,21 @@
 #pragma once
 
 namespace neural_acd {
+
+// how process() measures the concavity of the final decomposition
+enum ConcavityMode {
+  CONCAVITY_NONE, // not measured
+  CONCAVITY_FAST, // from the per-part concavities and the merge costs
+  CONCAVITY_FULL, // against the remeshed union of the hulls, FAST under a
+                  // time budget
+};
+
+// the engine fit_planes uses
+enum PlaneFitMode {
+  PLANE_FIT_JLINKAGE, // J-Linkage clustering of sampled hypotheses
+  PLANE_FIT_RANSAC,   // sequential RANSAC on estimated normals
+};
+
 class Config {
 public:
   float generation_cuboid_width_min;
@@ -16,13 +31,39 @@ public:
   double cost_rv_k;
 
   double merge_threshold;
+  bool merge_part_graph;  // merge across cuts, and uncut parts by distance
+  int merge_cache_size;   // max candidate merged hulls kept while merging
+  int max_parts;          // merge past the threshold down to this many hulls
+  bool merge_record_tree; // merge to one hull, keep the tree in the result
+
+  int max_ch_vertex;         // vertices per final hull, 0 for no limit
+  double ch_volume_increase; // relative volume simplification may add
 
+  PlaneFitMode plane_fit;
   double jlinkage_sigma;
   int jlinkage_num_samples;
-  double jlinkage_threshold;
-  int jlinkage_outlier_threshold;
+  double jlinkage_threshold;      // inlier distance, also for RANSAC
+  int jlinkage_outlier_threshold; // points a plane needs, also for RANSAC
+  double jlinkage_voxel_ratio; // voxel size over jlinkage_threshold, 0 for off
+  // fit groups of cut points further apart than this times jlinkage_sigma
+  // separately, 0 for one problem
+  double jlinkage_partition_ratio;
+  // approximate clustering: pairs are found by MinHash LSH with this many
+  // bands of jlinkage_lsh_rows hashes, 0 for exact
+  int jlinkage_lsh_bands;
+  int jlinkage_lsh_rows;
+  int ransac_max_iterations;  // hypotheses per plane, fewer once confident
+  double ransac_normal_angle; // degrees a point normal may be off the plane
+  int ransac_neighbours;      // used to estimate the normals
+
+  double refine_threshold; // recut parts more concave than this, 0 for off
+  int refine_depth;        // times a part may be recut
 
   bool process_output_parts;
+  ConcavityMode process_concavity;
+  double process_time_budget; // seconds per mesh, 0 for no limit
+
+  int num_threads; // 0 uses all hardware threads
 
   Config() {
     generation_cuboid_width_min = 0.1;
@@ -39,13 +80,35 @@ public:
     cost_rv_k = 0.03;
 
     merge_threshold = 0.005;
+    merge_part_graph = true;
+    merge_cache_size = 1024;
+    max_parts = 0;
+    merge_record_tree = false;
+
+    max_ch_vertex = 0;
+    ch_volume_increase = 0.05;
 
+    plane_fit = PLANE_FIT_JLINKAGE;
     jlinkage_sigma = 1.0;
     jlinkage_num_samples = 10000;
     jlinkage_threshold = 0.1;
     jlinkage_outlier_threshold = 10;
+    jlinkage_voxel_ratio = 0.0;
+    jlinkage_partition_ratio = 0.0;
+    jlinkage_lsh_bands = 0;
+    jlinkage_lsh_rows = 4;
+    ransac_max_iterations = 1000;
+    ransac_normal_angle = 20.0;
+    ransac_neighbours = 10;
+
+    refine_threshold = 0.0;
+    refine_depth = 2;
 
     process_output_parts = false;
+    process_concavity = CONCAVITY_FULL;
+    process_time_budget = 0.0;
+
+    num_threads = 0;
   }
 };
 
@@ -3,13 +3,18 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstdint>
 #include <random>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace neural_acd {
 
-inline std::mt19937 random_engine(std::random_device{}());
+// one engine per thread, so concurrent decompositions don't share state;
+// set_seed seeds the engine and restarts the sobol sequence of the calling
+// thread
+inline thread_local std::mt19937 random_engine(std::random_device{}());
 
 #define INF std::numeric_limits<double>::max()
 using Vec3D = std::array<double, 3>;
@@ -196,10 +201,29 @@ inline bool Plane::intersect_segment(Vec3D p1, Vec3D p2, Vec3D &pi,
   return false;
 }
 
+void compute_ch(const std::vector<Vec3D> &points, Mesh &convex);
+void compute_vch(const std::vector<Vec3D> &points, Mesh &convex);
+// convex hull of two convex hulls, built from the vertices of each hull that
+// lie outside the other one
+void merge_ch(const Mesh &ch1, const Mesh &ch2, Mesh &ch, double eps = 1e-7);
+// Replaces the convex hull ch by a polytope with at most max_vertex (>= 8)
+// vertices, cut from its bounding box by its own facet planes, deepest cut
+// first. The result is convex and contains ch. If it would grow the volume by
+// more than max_volume_increase (relative), ch is left as is. Returns true if
+// ch meets the limit.
+bool simplify_ch(Mesh &ch, int max_vertex, double max_volume_increase);
+
 void extract_point_set(Mesh &convex1, Mesh &convex2,
                        std::vector<Vec3D> &samples,
                        std::vector<int> &sample_tri_id, size_t resolution);
 
+void write_obj(const std::string &path, const Mesh &mesh);
+
 void set_seed(unsigned int seed);
+// seed for task index of a parallel loop drawing random numbers
+unsigned int task_seed(uint64_t base, uint64_t index);
+// hash of the exact vertex coordinates and triangles, for checking that two
+// runs produced bit-identical decompositions
+uint64_t decomposition_hash(const MeshList &meshes);
 
 } // namespace neural_acd
\ No newline at end of file
@@ -4,7 +4,10 @@
 
 namespace neural_acd {
 constexpr double Pi = 3.14159265;
+double get_mesh_volume(Mesh &mesh);
 double compute_rv(Mesh &cvx1, Mesh &cvx2, Mesh &cvxCH, double epsilon = 0.0001);
+// same as above, from the volumes of the two hulls and of their merged hull
+double compute_rv(double v1, double v2, double v3);
 double compute_hb(Mesh &cvx1, Mesh &cvx2, Mesh &cvxCH, unsigned int resolution);
 double compute_h(Mesh &cvx1, Mesh &cvx2, Mesh &cvxCH, double k,
                  unsigned int resolution, double epsilon = 0.0001);
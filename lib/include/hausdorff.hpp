@@ -40,54 +40,12 @@ SOFTWARE.
 
 #include "clip.hpp"
 #include "core.hpp"
-#include "nanoflann.hpp"
+#include "kdtree.hpp"
 using namespace std;
 using namespace nanoflann;
 
 namespace neural_acd {
 
-template <typename T> struct PointCloud {
-  struct Point {
-    T x, y, z;
-  };
-
-  std::vector<Point> pts;
-
-  // Must return the number of data points
-  inline size_t kdtree_get_point_count() const { return pts.size(); }
-
-  // Returns the dim'th component of the idx'th point in the class:
-  // Since this is inlined and the "dim" argument is typically an immediate
-  // value, the
-  //  "if/else's" are actually solved at compile time.
-  inline T kdtree_get_pt(const size_t idx, const size_t dim) const {
-    if (dim == 0)
-      return pts[idx].x;
-    else if (dim == 1)
-      return pts[idx].y;
-    else
-      return pts[idx].z;
-  }
-
-  // Optional bounding-box computation: return false to default to a standard
-  // bbox computation loop.
-  //   Return true if the BBOX was already computed by the class and returned in
-  //   "bb" so it can be avoided to redo it again. Look at bb.size() to find out
-  //   the expected dimensionality (e.g. 2 or 3 for point clouds)
-  template <class BBOX> bool kdtree_get_bbox(BBOX & /* bb */) const {
-    return false;
-  }
-};
-
-template <typename T> void vec2pc(PointCloud<T> &point, vector<Vec3D> V) {
-  point.pts.resize(V.size());
-  for (size_t i = 0; i < V.size(); i++) {
-    point.pts[i].x = V[i][0];
-    point.pts[i].y = V[i][1];
-    point.pts[i].z = V[i][2];
-  }
-}
-
 inline bool same_vector_dir(Vec3D v, Vec3D w) {
   if (v[0] * w[0] + v[1] * w[1] + v[2] * w[2] > 0)
     return true;
@@ -1,38 +1,99 @@
 #pragma once
 #include <core.hpp>
+#include <cstdint>
+#include <plane_extractor.hpp>
 #include <utility>
 #include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 using namespace std;
 
 namespace neural_acd {
 
 namespace detail {
-using BoolVec = vector<bool>;
-using BoolMat = vector<BoolVec>;
+// one bit per hypothesis, packed into 64-bit words
+using BitVec = vector<uint64_t>;
+using BitMat = vector<BitVec>;
+
+inline int popcount(uint64_t word) {
+#if defined(_MSC_VER)
+  return (int)__popcnt64(word);
+#else
+  return __builtin_popcountll(word);
+#endif
+}
+
+// A sampled plane n.x + d = 0
+struct Hypothesis {
+  Vec3D n;
+  double d;
+  bool valid = false; // degenerate triplet, or not sampled within the budget
+};
+
+// Walker alias table over the entries of a row of probabilities, to draw
+// one in O(1)
+struct AliasTable {
+  vector<double> prob;
+  vector<int> alias;
+  void build(const vector<pair<int, double>> &row);
+  int sample() const; // index in the row, using random_engine
+};
 } // namespace detail
 
-class JLinkage {
+class JLinkage : public PlaneExtractor {
 public:
+  // With voxel_size_ > 0 the points are downsampled to one per voxel. With
+  // lsh_bands_ > 0 only pairs found by MinHash LSH, in that many bands of
+  // lsh_rows_ hashes, are considered for merging.
   JLinkage(double sigma_ = 1, int num_samples_ = 10000, double threshold_ = 0.1,
-           int outlier_threshold_ = 10);
+           int outlier_threshold_ = 10, double voxel_size_ = 0,
+           int lsh_bands_ = 0, int lsh_rows_ = 4);
+
+  void set_points(const vector<Vec3D> &pts) override;
+  vector<Plane> get_best_planes() override;
 
-  void set_points(const vector<Vec3D> &pts);
-  vector<Plane> get_best_planes();
+  // Changes the inlier distance. The sampled hypotheses are kept and only
+  // thresholded again, then the points are clustered again on demand.
+  void set_threshold(double threshold_);
+  // changes the points a cluster needs to give a plane, without reclustering
+  void set_outlier_threshold(int outlier_threshold_);
+  // every cluster of input points, also those too small to give a plane
+  const vector<vector<int>> &get_clusters();
 
 private:
   double sigma;
   int num_samples;
   double threshold;
   int outlier_threshold;
-  vector<Vec3D> points;
-  vector<vector<double>> sample_probs;
-  detail::BoolMat preference_set;
+  double voxel_size;
+  int lsh_bands;
+  int lsh_rows;
+  vector<Vec3D> points; // the voxel centroids when downsampling
+  // when downsampling, the input points and the ones in each voxel
+  vector<Vec3D> full_points;
+  vector<vector<int>> members;
+  detail::AliasTable point_table; // draws voxels by their number of points
+  // sampling probabilities of the neighbours of every point, as (neighbour,
+  // probability) sorted by neighbour
+  vector<vector<pair<int, double>>> sample_probs;
+  vector<detail::AliasTable> sample_tables; // one per row of sample_probs
+  vector<double> max_probs;                 // largest entry of each row
+  vector<detail::Hypothesis> hypotheses;
+  detail::BitMat preference_set; // consumed by clustering
+  vector<vector<int>> clusters;
+  bool clustered = false;
+  void downsample(const vector<Vec3D> &pts);
   void calculate_distances();
-  void sample_triplet(int &i1, int &i2, int &i3);
+  double sample_prob(int i, int j) const;
+  void sample_triplet(int &i1, int &i2, int &i3) const;
+  void sample_hypotheses();
   void calculate_preference_sets();
-  double jaccard_distance(const detail::BoolVec &a, const detail::BoolVec &b);
-  vector<Plane> cluster_planes(vector<vector<int>> &clusters);
+  void cluster();
+  vector<vector<int>> lsh_candidates() const;
+  double jaccard_distance(const detail::BitVec &a, const detail::BitVec &b);
+  vector<Plane> cluster_planes(const vector<vector<int>> &clusters);
 };
 
 } // namespace neural_acd
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+
+namespace neural_acd {
+
+// Input sizes and event counts of one process() run
+struct Metrics {
+  long input_vertices = 0;
+  long input_triangles = 0;
+  long cut_points = 0;
+  long planes = 0;
+  long clip_calls = 0;
+  long clips_skipped = 0; // the plane missed the part
+  long cdt_failures = 0;  // cap triangulations that failed
+  long vch_fallbacks = 0; // quickhull failed and compute_vch was used
+  long merge_iterations = 0;
+  long peak_parts = 0;
+  long output_hulls = 0;
+  long max_hull_vertices = 0;
+  long hulls_over_vertex_limit = 0; // simplification could not reach it
+  long budget_stops = 0; // places a stage stopped early for the time budget
+};
+
+// Counters of the run in progress. The stages reach them through
+// current_counters, which parallel_for hands on to its worker threads.
+struct MetricsCounters {
+  std::atomic<long> clip_calls{0};
+  std::atomic<long> clips_skipped{0};
+  std::atomic<long> cdt_failures{0};
+  std::atomic<long> vch_fallbacks{0};
+  std::atomic<long> merge_iterations{0};
+  std::atomic<long> peak_parts{0};
+  std::atomic<long> budget_stops{0};
+  // CPU time of the parallel_for workers, which the stage timers add to that
+  // of the calling thread
+  std::atomic<long long> worker_cpu_ns{0};
+
+  void add_to(Metrics &metrics) const {
+    metrics.clip_calls += clip_calls;
+    metrics.clips_skipped += clips_skipped;
+    metrics.cdt_failures += cdt_failures;
+    metrics.vch_fallbacks += vch_fallbacks;
+    metrics.merge_iterations += merge_iterations;
+    metrics.peak_parts = std::max(metrics.peak_parts, peak_parts.load());
+    metrics.budget_stops += budget_stops;
+  }
+};
+
+inline thread_local MetricsCounters *current_counters = nullptr;
+
+// CPU seconds used by the calling thread
+double thread_cpu_time();
+
+// no-ops outside of a run, e.g. when a stage is called on its own
+inline void count_event(std::atomic<long> MetricsCounters::*counter,
+                        long n = 1) {
+  if (current_counters)
+    (current_counters->*counter) += n;
+}
+
+inline void count_worker_cpu(double seconds) {
+  if (current_counters)
+    current_counters->worker_cpu_ns += (long long)(seconds * 1e9);
+}
+
+inline void count_parts(long n) {
+  if (!current_counters)
+    return;
+  long peak = current_counters->peak_parts;
+  while (n > peak &&
+         !current_counters->peak_parts.compare_exchange_weak(peak, n))
+    ;
+}
+
+// makes counters the current counters of this thread until destroyed
+class MetricsScope {
+public:
+  explicit MetricsScope(MetricsCounters *counters) : prev(current_counters) {
+    current_counters = counters;
+  }
+  ~MetricsScope() { current_counters = prev; }
+  MetricsScope(const MetricsScope &) = delete;
+  MetricsScope &operator=(const MetricsScope &) = delete;
+
+private:
+  MetricsCounters *prev;
+};
+
+} // namespace neural_acd
\ No newline at end of file
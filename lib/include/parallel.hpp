@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <budget.hpp>
+#include <config.hpp>
+#include <core.hpp>
+#include <cstdint>
+#include <exception>
+#include <metrics.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace neural_acd {
+
+// set on worker threads so that nested loops run serially
+inline thread_local bool in_parallel_region = false;
+
+// Progress and per-item results are only printed outside parallel loops,
+// where the output of concurrent items would interleave.
+inline bool show_progress() { return !in_parallel_region; }
+
+inline int num_threads() {
+  if (config.num_threads > 0)
+    return config.num_threads;
+  int n = (int)std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+// Runs fn(i) for every i in [0, n) on up to num_threads() threads. Every
+// index is processed exactly once, so as long as fn(i) only writes to its own
+// slot the result does not depend on the number of threads. The first
+// exception thrown by fn is rethrown on the calling thread.
+template <typename Fn> void parallel_for(int n, Fn fn) {
+  int workers = in_parallel_region ? 1 : std::min(num_threads(), n);
+  if (workers <= 1) {
+    for (int i = 0; i < n; i++)
+      fn(i);
+    return;
+  }
+
+  std::atomic<int> next(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  MetricsCounters *counters = current_counters;
+  const Deadline *deadline = current_deadline;
+  // the calling thread is timed by its caller, the workers count their own
+  // CPU time
+  auto run = [&](bool worker) {
+    bool nested = in_parallel_region;
+    in_parallel_region = true;
+    MetricsScope scope(counters);
+    DeadlineScope deadline_scope(deadline);
+    double cpu_start = worker ? thread_cpu_time() : 0.0;
+    for (int i = next++; i < n; i = next++) {
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+          error = std::current_exception();
+        next = n;
+      }
+    }
+    if (worker)
+      count_worker_cpu(thread_cpu_time() - cpu_start);
+    in_parallel_region = nested;
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < workers; t++)
+    threads.emplace_back(run, true);
+  run(false);
+  for (auto &t : threads)
+    t.join();
+  if (error)
+    std::rethrow_exception(error);
+}
+
+// parallel_for for loops drawing random numbers. Every index runs with the
+// generators seeded from (one draw of the caller's engine, index), and the
+// caller's generators are reseeded the same way afterwards, so the results
+// and the caller's later draws do not depend on the number of threads.
+template <typename Fn> void parallel_for_seeded(int n, Fn fn) {
+  uint64_t base = random_engine();
+  parallel_for(n, [&](int i) {
+    set_seed(task_seed(base, i));
+    fn(i);
+  });
+  set_seed(task_seed(base, n));
+}
+
+} // namespace neural_acd
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <core.hpp>
+#include <memory>
+#include <vector>
+
+namespace neural_acd {
+
+// Fits cut planes to a set of cut points
+class PlaneExtractor {
+public:
+  virtual ~PlaneExtractor() = default;
+  virtual void set_points(const std::vector<Vec3D> &pts) = 0;
+  virtual std::vector<Plane> get_best_planes() = 0;
+};
+
+// the extractor chosen by config.plane_fit, with its settings from config
+std::unique_ptr<PlaneExtractor> make_plane_extractor();
+
+} // namespace neural_acd
\ No newline at end of file
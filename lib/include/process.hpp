@@ -1,9 +1,140 @@
 #pragma once
 
+#include <clip.hpp>
 #include <core.hpp>
+#include <functional>
+#include <metrics.hpp>
+#include <string>
+#include <vector>
 
 namespace neural_acd {
+
+// Timing and output size of one pipeline stage
+struct StageStats {
+  std::string name;
+  double wall_time = 0.0; // seconds
+  double cpu_time = 0.0;  // CPU seconds of the run, summed over its threads
+  int items = 0;
+  bool truncated = false; // stopped early for config.process_time_budget
+};
+
+// One merge of a MergeTree: nodes node1 and node2 make a new node
+struct MergeStep {
+  int node1 = 0, node2 = 0;
+  double cost = 0.0;
+  bool forced = false; // made after the merge candidates ran out
+};
+
+// Record of a greedy merge down to one hull. Nodes 0 to num_leaves - 1 are
+// the hulls before merging, steps[k] makes node num_leaves + k. Greedy merging
+// stops at a threshold or part count without changing its earlier choices, so
+// the hulls of any such run are the nodes left after a prefix of the steps.
+// Candidates found by distance, which are all pairs with
+// config.merge_part_graph off and those of hulls without a part graph edge
+// otherwise, stay the pairs closer than the config.merge_threshold the tree
+// was recorded with.
+struct MergeTree {
+  int num_leaves = 0;
+  MeshList nodes;
+  std::vector<MergeStep> steps;
+
+  // number of steps merge_hulls would take with this threshold and part cap
+  int num_steps(double threshold, int max_parts = 0) const;
+  // the hulls after the first n steps, in the order merge_hulls leaves them
+  MeshList slice(int n) const;
+  MeshList slice_threshold(double threshold) const;
+  MeshList slice_parts(int num_parts) const;
+  // highest cost of the first n steps
+  double max_cost(int n) const;
+};
+
+struct ProcessResult {
+  MeshList parts; // parts before merging
+  MeshList cvxs;  // merged convex hulls
+  double concavity = 0.0; // NaN when config.process_concavity is NONE
+  std::vector<StageStats> stages;
+  Metrics metrics;
+  bool truncated = false; // some stage was truncated
+  MergeTree merge_tree;    // only with config.merge_record_tree
+};
+
+enum ProcessStatus {
+  PROCESS_OK = 0,
+  PROCESS_EMPTY_MESH = 1, // the mesh has no vertices or triangles
+  PROCESS_FAILED = 2,     // an exception was thrown, see BatchResult::error
+};
+
+struct BatchResult {
+  ProcessStatus status = PROCESS_OK;
+  std::string error;
+  ProcessResult result;
+};
+
 MeshList process(Mesh mesh, std::vector<Vec3D> cut_points,
                  std::string stats_file = "");
+// same pipeline, also returning the parts, the statistics of every stage and
+// the run's counters, which are appended to metrics_file if one is given
+ProcessResult process_timed(Mesh mesh, std::vector<Vec3D> cut_points,
+                            std::string stats_file = "",
+                            std::string metrics_file = "");
+using HullCallback = std::function<void(const Mesh &)>;
+// Same pipeline, handing every final hull to emit instead of keeping it. Hulls
+// the part graph leaves without merge candidates are emitted before merging,
+// the rest once merging ends. The result holds no parts or hulls. The full
+// concavity check still needs every hull, so memory is only saved with
+// config.process_concavity FAST or NONE.
+ProcessResult process_stream(Mesh mesh, std::vector<Vec3D> cut_points,
+                             const HullCallback &emit,
+                             std::string stats_file = "",
+                             std::string metrics_file = "");
+// callback writing the hulls to directory/hull_<n>.obj
+HullCallback obj_writer(std::string directory);
+// appends one record per call: a JSON line if the file name ends in .json,
+// otherwise a CSV row (with a header if the file is new)
+void write_metrics(std::string metrics_file, const ProcessResult &result);
+// Decomposes meshes[i] with cut_points[i] for every i, running the meshes
+// concurrently. Each mesh is seeded from the caller's engine and its index,
+// so a batch gives the same results at any thread count. Results are in input
+// order; the stats and metrics of successful meshes are appended to
+// stats_file and metrics_file in the same order.
+std::vector<BatchResult>
+process_batch(const MeshList &meshes,
+              const std::vector<std::vector<Vec3D>> &cut_points,
+              std::string stats_file = "", std::string metrics_file = "");
+
+// Pipeline stages, in the order process() runs them
+void normalize_input(Mesh &mesh, std::vector<Vec3D> &cut_points);
+std::vector<Plane> fit_planes(const std::vector<Vec3D> &cut_points);
+// clipping is multiclip(mesh, planes, graph)
+// splits parts into connected components, remapping the adjacency graph onto
+// the components
+void separate_disjoint(MeshList &parts, PartGraph &graph);
+void separate_disjoint(MeshList &parts);
+// hulls of the parts, of their bounding boxes after the time budget ran out
+MeshList compute_hulls(const MeshList &parts);
+// Recuts the parts more concave than config.refine_threshold with planes
+// fitted to the cut points around each of them, up to config.refine_depth
+// times, and updates their hulls and the graph. Returns how many parts were
+// recut.
+int refine_parts(MeshList &parts, MeshList &cvxs, PartGraph &graph,
+                 const std::vector<Vec3D> &cut_points);
+// concavity of every part against its own hull, 0 for the parts reached
+// after the time budget ran out
+std::vector<double> compute_part_concavity(MeshList &parts, MeshList &cvxs);
+// merges hulls in place, returns the highest merge cost. Throws
+// std::invalid_argument if graph refers to a part not in cvxs.
+double merge_hulls(MeshList &cvxs, const PartGraph &graph);
+// merges copies of the hulls down to one, recording every step; throws like
+// merge_hulls
+MergeTree record_merge_tree(const MeshList &cvxs, const PartGraph &graph);
+// applies config.max_ch_vertex to every hull, returns how many still exceed it
+int simplify_hulls(MeshList &cvxs);
+Mesh remesh_hulls(const MeshList &cvxs);
+// emits the hulls without part graph edges that are further than
+// config.merge_threshold from every other hull, removing them from cvxs and
+// renumbering the graph
+void emit_isolated_hulls(MeshList &cvxs, PartGraph &graph,
+                         const HullCallback &emit);
+double compute_concavity(Mesh &mesh, Mesh &hull);
 
 } // namespace neural_acd
\ No newline at end of file
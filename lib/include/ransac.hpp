@@ -0,0 +1,36 @@
+#pragma once
+
+#include <core.hpp>
+#include <plane_extractor.hpp>
+#include <vector>
+
+namespace neural_acd {
+
+// Sequential RANSAC: finds the plane with the most inliers, removes them and
+// repeats. Each hypothesis is one point with its estimated normal, and
+// sampling for a plane stops once it has been found with the given
+// confidence.
+class Ransac : public PlaneExtractor {
+public:
+  Ransac(double threshold_ = 0.1, int min_support_ = 10,
+         int max_iterations_ = 1000, double normal_angle_ = 20,
+         int num_neighbours_ = 10, double confidence_ = 0.99);
+
+  void set_points(const std::vector<Vec3D> &pts) override;
+  std::vector<Plane> get_best_planes() override;
+
+private:
+  double threshold;   // inlier distance
+  int min_support;    // inliers a plane needs
+  int max_iterations; // hypotheses per plane
+  double min_normal_dot;
+  int num_neighbours;
+  double confidence;
+  std::vector<Vec3D> points;
+  std::vector<Vec3D> normals;
+  void estimate_normals();
+  std::vector<int> inliers(const std::vector<int> &candidates, const Vec3D &n,
+                           double d) const;
+};
+
+} // namespace neural_acd
\ No newline at end of file
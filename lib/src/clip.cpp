@@ -24,10 +24,12 @@ SOFTWARE.
 #include "core.hpp"
 #include <CDT.h>
 #include <CDTUtils.h>
+#include <budget.hpp>
 #include <cost.hpp>
 #include <deque>
 #include <iostream>
 #include <map>
+#include <metrics.hpp>
 #include <preprocess.hpp>
 #include <string>
 
@@ -413,6 +415,7 @@ void RemoveOutlierTriangles(std::vector<Vec3D> border,
 }
 
 MeshList clip(const Mesh mesh, Plane plane) {
+  count_event(&MetricsCounters::clip_calls);
   Mesh t = mesh;
   Mesh pos, neg;
   std::vector<Vec3D> border;
@@ -745,6 +748,8 @@ MeshList clip(const Mesh mesh, Plane plane) {
   if (border.size() > 2) {
     int oriN = (int)border.size();
     short flag = Triangulation(border, border_edges, border_triangles, plane);
+    if (flag == 2)
+      count_event(&MetricsCounters::cdt_failures);
     final_border = border;
     final_triangles = border_triangles;
     // if (flag == 0)
@@ -883,21 +888,114 @@ MeshList clip(const Mesh mesh, Plane plane) {
   return mesh_list;
 }
 
+PlaneContact plane_contact(const Mesh &mesh, Plane plane, double eps) {
+  PlaneContact contact;
+  for (const auto &tri : mesh.triangles) {
+    int on_plane = 0;
+    for (int k = 0; k < 3; k++) {
+      const Vec3D &v = mesh.vertices[tri[k]];
+      if (plane.side(v, eps) != 0)
+        continue;
+      on_plane++;
+      contact.touches = true;
+      for (int d = 0; d < 3; d++) {
+        contact.min[d] = std::min(contact.min[d], v[d]);
+        contact.max[d] = std::max(contact.max[d], v[d]);
+      }
+    }
+    if (on_plane == 3)
+      contact.area += triangle_area(mesh.vertices[tri[0]],
+                                    mesh.vertices[tri[1]],
+                                    mesh.vertices[tri[2]]);
+  }
+  return contact;
+}
+
+bool contacts_overlap(const PlaneContact &c1, const PlaneContact &c2,
+                      double eps) {
+  if (!c1.touches || !c2.touches)
+    return false;
+  for (int d = 0; d < 3; d++)
+    if (c1.min[d] > c2.max[d] + eps || c2.min[d] > c1.max[d] + eps)
+      return false;
+  return true;
+}
+
+PartGraph remap_part_graph(const PartGraph &graph,
+                           const std::vector<std::vector<int>> &children,
+                           const MeshList &new_parts) {
+  PartGraph new_graph;
+  std::map<std::pair<int, int>, PlaneContact> contacts; // (part, plane id)
+  auto contact = [&](int part,
+                     const PartAdjacency &edge) -> const PlaneContact & {
+    std::pair<int, int> key(part, edge.plane_id);
+    auto it = contacts.find(key);
+    if (it == contacts.end())
+      it = contacts.emplace(key, plane_contact(new_parts[part], edge.plane))
+               .first;
+    return it->second;
+  };
+
+  for (const auto &edge : graph) {
+    const auto &pieces1 = children[edge.part1], &pieces2 = children[edge.part2];
+    if (pieces1.size() == 1 && pieces2.size() == 1) {
+      new_graph.push_back(
+          {pieces1[0], pieces2[0], edge.plane_id, edge.plane, edge.area});
+      continue;
+    }
+    for (int a : pieces1) {
+      for (int b : pieces2) {
+        const PlaneContact &ca = contact(a, edge);
+        const PlaneContact &cb = contact(b, edge);
+        if (contacts_overlap(ca, cb))
+          new_graph.push_back(
+              {a, b, edge.plane_id, edge.plane, std::min(ca.area, cb.area)});
+      }
+    }
+  }
+  return new_graph;
+}
+
 MeshList multiclip(const Mesh mesh, const std::vector<Plane> &planes) {
+  PartGraph graph;
+  return multiclip(mesh, planes, graph);
+}
+
+MeshList multiclip(const Mesh mesh, const std::vector<Plane> &planes,
+                   PartGraph &graph) {
   MeshList mesh_list;
   mesh_list.push_back(mesh);
-  for (const auto &plane : planes) {
+  graph.clear();
+  for (int p = 0; p < (int)planes.size(); p++) {
+    if (out_of_time())
+      break; // keep the parts cut so far
+    MeshList next;
+    std::vector<std::vector<int>> children(mesh_list.size());
+    PartGraph cut_edges; // the two halves of a split part share its cap
     for (int i = mesh_list.size() - 1; i >= 0; i--) {
-      Mesh m = mesh_list[i];
-      mesh_list.erase(mesh_list.begin() + i);
-      MeshList clipped = neural_acd::clip(m, plane);
+      MeshList clipped = neural_acd::clip(mesh_list[i], planes[p]);
       for (auto &c : clipped) {
         if (c.triangles.empty() || c.vertices.empty())
           continue; // skip empty meshes
         // manifold_preprocess(c);
-        mesh_list.push_back(c);
+        children[i].push_back(next.size());
+        next.push_back(c);
       }
+      if (children[i].size() == 2)
+        cut_edges.push_back(
+            {children[i][0], children[i][1], p, planes[p], 0.0});
+      else
+        count_event(&MetricsCounters::clips_skipped);
+    }
+    count_parts(next.size());
+
+    graph = remap_part_graph(graph, children, next);
+    for (auto &edge : cut_edges) {
+      edge.area = std::min(plane_contact(next[edge.part1], edge.plane).area,
+                           plane_contact(next[edge.part2], edge.plane).area);
+      graph.push_back(edge);
     }
+    mesh_list = std::move(next);
   }
 
   return mesh_list;
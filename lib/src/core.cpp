@@ -6,36 +6,94 @@
 #include <boost/random/variate_generator.hpp>
 #include <btConvexHullComputer.h>
 #include <cmath>
+#include <cost.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <metrics.hpp>
+#include <parallel.hpp>
 #include <random>
 #include <stdexcept>
 
 namespace neural_acd {
 
-boost::random::sobol sobol_engine(2);
+thread_local boost::random::sobol sobol_engine(2);
 boost::uniform_01<double> uniform_dist;
-boost::variate_generator<boost::random::sobol &, boost::uniform_01<double>>
+thread_local boost::variate_generator<boost::random::sobol &,
+                                      boost::uniform_01<double>>
     sobol_gen(sobol_engine, uniform_dist);
 
-void set_seed(unsigned int seed) { random_engine.seed(seed); }
+void set_seed(unsigned int seed) {
+  random_engine.seed(seed);
+  sobol_engine.seed(); // restart the quasirandom sequence
+}
+
+unsigned int task_seed(uint64_t base, uint64_t index) {
+  // splitmix64 of the pair, so neighbouring indices get unrelated seeds
+  uint64_t z = base + (index + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z = z ^ (z >> 31);
+  return (unsigned int)(z ^ (z >> 32));
+}
+
+uint64_t decomposition_hash(const MeshList &meshes) {
+  // FNV-1a over the bits of every coordinate and index
+  uint64_t h = 0xcbf29ce484222325ULL;
+  auto mix = [&h](uint64_t v) {
+    for (int b = 0; b < 8; b++) {
+      h ^= (v >> (8 * b)) & 0xff;
+      h *= 0x100000001b3ULL;
+    }
+  };
+  mix(meshes.size());
+  for (auto &mesh : meshes) {
+    mix(mesh.vertices.size());
+    for (auto &v : mesh.vertices)
+      for (double c : v) {
+        uint64_t bits;
+        std::memcpy(&bits, &c, sizeof(bits));
+        mix(bits);
+      }
+    mix(mesh.triangles.size());
+    for (auto &tri : mesh.triangles)
+      for (int i : tri)
+        mix((uint32_t)i);
+  }
+  return h;
+}
+
+void write_obj(const std::string &path, const Mesh &mesh) {
+  std::ofstream f(path);
+  if (!f)
+    throw std::runtime_error("cannot open " + path);
+  f.precision(10);
+  for (auto &v : mesh.vertices)
+    f << "v " << v[0] << " " << v[1] << " " << v[2] << "\n";
+  for (auto &tri : mesh.triangles)
+    f << "f " << tri[0] + 1 << " " << tri[1] + 1 << " " << tri[2] + 1 << "\n";
+}
 
 Mesh::Mesh() {}
 
-void Mesh::compute_ch(Mesh &convex) const {
+void compute_ch(const std::vector<Vec3D> &points, Mesh &convex) {
   /* fast convex hull algorithm */
   bool flag = true;
   quickhull::QuickHull<float> qh; // Could be double as well
   vector<quickhull::Vector3<float>> pointCloud;
+  pointCloud.reserve(points.size());
   // Add vertices to point cloud
-  for (int i = 0; i < (int)vertices.size(); i++) {
-    pointCloud.push_back(quickhull::Vector3<float>(
-        vertices[i][0], vertices[i][1], vertices[i][2]));
+  for (int i = 0; i < (int)points.size(); i++) {
+    pointCloud.push_back(
+        quickhull::Vector3<float>(points[i][0], points[i][1], points[i][2]));
   }
 
   auto hull = qh.getConvexHull(pointCloud, true, false, flag);
   if (!flag) {
     // backup convex hull algorithm, stable but slow
-    compute_vch(convex);
+    count_event(&MetricsCounters::vch_fallbacks);
+    compute_vch(points, convex);
     return;
   }
   const auto &indexBuffer = hull.getIndexBuffer();
@@ -50,9 +108,9 @@ void Mesh::compute_ch(Mesh &convex) const {
   }
 }
 
-void Mesh::compute_vch(Mesh &convex) const {
+void compute_vch(const std::vector<Vec3D> &points, Mesh &convex) {
   btConvexHullComputer ch;
-  ch.compute(vertices, -1.0, -1.0);
+  ch.compute(points, -1.0, -1.0);
   for (int32_t v = 0; v < ch.vertices.size(); v++) {
     convex.vertices.push_back(
         {ch.vertices[v].getX(), ch.vertices[v].getY(), ch.vertices[v].getZ()});
@@ -73,6 +131,240 @@ void Mesh::compute_vch(Mesh &convex) const {
   }
 }
 
+// Appends the vertices of src that are not strictly inside the convex hull
+// ch, i.e. the only ones that can be extreme points of the union
+bool add_outside_vertices(const Mesh &src, const Mesh &ch,
+                          std::vector<Vec3D> &points, double eps) {
+  Vec3D center = {0.0, 0.0, 0.0};
+  Vec3D min = {INF, INF, INF}, max = {-INF, -INF, -INF};
+  for (const auto &v : ch.vertices) {
+    center = center + v;
+    for (int k = 0; k < 3; k++) {
+      min[k] = std::min(min[k], v[k]);
+      max[k] = std::max(max[k], v[k]);
+    }
+  }
+  if (!ch.vertices.empty())
+    center = center / (double)ch.vertices.size();
+
+  // face planes, oriented so that the center is on the negative side
+  std::vector<Plane> faces;
+  faces.reserve(ch.triangles.size());
+  double inradius = INF;
+  for (const auto &tri : ch.triangles) {
+    Vec3D n = cross_product(ch.vertices[tri[1]] - ch.vertices[tri[0]],
+                            ch.vertices[tri[2]] - ch.vertices[tri[0]]);
+    double len = vector_length(n);
+    if (len == 0)
+      continue;
+    n = n / len;
+    double d = -dot(n, ch.vertices[tri[0]]);
+    double dist = dot(n, center) + d;
+    if (dist > 0) {
+      n = n * -1.0;
+      d = -d;
+    }
+    inradius = std::min(inradius, fabs(dist));
+    faces.push_back(Plane(n[0], n[1], n[2], d));
+  }
+  if (faces.empty())
+    inradius = 0;
+
+  bool added = false;
+  for (const auto &v : src.vertices) {
+    bool inside = !faces.empty();
+    for (int k = 0; k < 3 && inside; k++)
+      if (v[k] <= min[k] + eps || v[k] >= max[k] - eps)
+        inside = false;
+    // points in the inscribed sphere need no face tests
+    if (inside && vector_length(v - center) >= inradius - eps) {
+      for (const auto &f : faces) {
+        if (f.a * v[0] + f.b * v[1] + f.c * v[2] + f.d > -eps) {
+          inside = false;
+          break;
+        }
+      }
+    }
+    if (!inside) {
+      points.push_back(v);
+      added = true;
+    }
+  }
+  return added;
+}
+
+void merge_ch(const Mesh &ch1, const Mesh &ch2, Mesh &ch, double eps) {
+  std::vector<Vec3D> points;
+  points.reserve(ch1.vertices.size() + ch2.vertices.size());
+  bool outside1 = add_outside_vertices(ch1, ch2, points, eps);
+  bool outside2 = add_outside_vertices(ch2, ch1, points, eps);
+
+  // one hull contains the other, the merge is the outer hull itself
+  if (!outside1) {
+    ch.vertices = ch2.vertices;
+    ch.triangles = ch2.triangles;
+    return;
+  }
+  if (!outside2) {
+    ch.vertices = ch1.vertices;
+    ch.triangles = ch1.triangles;
+    return;
+  }
+  compute_ch(points, ch);
+}
+
+// convex hull in double precision, for results that must not cut into the
+// input
+void compute_ch_double(const std::vector<Vec3D> &points, Mesh &convex) {
+  bool flag = true;
+  quickhull::QuickHull<double> qh;
+  std::vector<quickhull::Vector3<double>> pointCloud;
+  pointCloud.reserve(points.size());
+  for (auto &p : points)
+    pointCloud.push_back(quickhull::Vector3<double>(p[0], p[1], p[2]));
+  auto hull = qh.getConvexHull(pointCloud, true, false, flag);
+  if (!flag) {
+    compute_vch(points, convex);
+    return;
+  }
+  const auto &indexBuffer = hull.getIndexBuffer();
+  const auto &vertexBuffer = hull.getVertexBuffer();
+  for (auto &v : vertexBuffer)
+    convex.vertices.push_back({v.x, v.y, v.z});
+  for (size_t i = 0; i < indexBuffer.size(); i += 3)
+    convex.triangles.push_back({(int)indexBuffer[i + 2],
+                                (int)indexBuffer[i + 1], (int)indexBuffer[i]});
+}
+
+struct Halfspace {
+  Vec3D n; // unit normal
+  double d; // n.(x - c) <= d, c being a point inside
+};
+
+// intersection of halfspaces, through the convex hull of the dual points
+// n / d; false if the intersection is unbounded
+bool intersect_halfspaces(const std::vector<Halfspace> &halfspaces, Vec3D c,
+                          Mesh &polytope) {
+  std::vector<quickhull::Vector3<double>> dual;
+  Vec3D dual_center = {0, 0, 0};
+  for (auto &h : halfspaces) {
+    Vec3D p = h.n / h.d;
+    dual.push_back(quickhull::Vector3<double>(p[0], p[1], p[2]));
+    dual_center = dual_center + p / (double)halfspaces.size();
+  }
+
+  bool flag = true;
+  quickhull::QuickHull<double> qh;
+  auto hull = qh.getConvexHull(dual, true, false, flag);
+  if (!flag)
+    return false;
+  const auto &indexBuffer = hull.getIndexBuffer();
+  const auto &vertexBuffer = hull.getVertexBuffer();
+
+  // every dual facet m.p = e is a primal vertex m / e
+  std::vector<Vec3D> vertices;
+  for (size_t i = 0; i < indexBuffer.size(); i += 3) {
+    Vec3D p[3];
+    for (int k = 0; k < 3; k++) {
+      const auto &v = vertexBuffer[indexBuffer[i + k]];
+      p[k] = {v.x, v.y, v.z};
+    }
+    Vec3D m = cross_product(p[1] - p[0], p[2] - p[0]);
+    if (dot(m, p[0] - dual_center) < 0)
+      m = m * -1.0;
+    double e = dot(m, p[0]);
+    if (e <= 1e-12 * vector_length(m))
+      return false; // the origin is on the dual hull, c is not enclosed
+    vertices.push_back(m / e + c);
+  }
+  polytope.clear();
+  compute_ch_double(vertices, polytope);
+  return true;
+}
+
+bool simplify_ch(Mesh &ch, int max_vertex, double max_volume_increase) {
+  if (max_vertex <= 0 || (int)ch.vertices.size() <= max_vertex)
+    return true;
+  if (ch.vertices.empty())
+    return false;
+
+  Vec3D c = {0, 0, 0};
+  for (auto &v : ch.vertices)
+    c = c + v / (double)ch.vertices.size();
+
+  // supporting planes of the hull: its facets and its bounding box
+  std::vector<Halfspace> facets;
+  for (auto &tri : ch.triangles) {
+    const Vec3D &v0 = ch.vertices[tri[0]];
+    Vec3D n =
+        cross_product(ch.vertices[tri[1]] - v0, ch.vertices[tri[2]] - v0);
+    double len = vector_length(n);
+    if (len < 1e-12)
+      continue;
+    n = n / len;
+    double d = dot(n, v0 - c);
+    for (auto &v : ch.vertices) // exact support, also for float hulls
+      d = std::max(d, dot(n, v - c));
+    facets.push_back({n, d});
+  }
+  std::vector<Halfspace> planes;
+  for (int axis = 0; axis < 3; axis++)
+    for (double sign : {1.0, -1.0}) {
+      Vec3D n = {0, 0, 0};
+      n[axis] = sign;
+      double d = -INF;
+      for (auto &v : ch.vertices)
+        d = std::max(d, dot(n, v - c));
+      planes.push_back({n, d});
+    }
+  for (auto &h : planes)
+    if (h.d <= 1e-9)
+      return false; // flat hull
+
+  // start from the bounding box and add the facet plane cutting deepest into
+  // the current polytope while the vertex limit holds
+  Mesh best;
+  if (!intersect_halfspaces(planes, c, best))
+    return false;
+  if ((int)best.vertices.size() > max_vertex)
+    return false; // below a box
+  while (true) {
+    double depth = 1e-9;
+    int deepest = -1;
+    for (size_t i = 0; i < facets.size(); i++)
+      for (auto &v : best.vertices) {
+        double out = dot(facets[i].n, v - c) - facets[i].d;
+        if (out > depth) {
+          depth = out;
+          deepest = i;
+        }
+      }
+    if (deepest < 0)
+      break; // the polytope is the hull
+    planes.push_back(facets[deepest]);
+    Mesh candidate;
+    if (!intersect_halfspaces(planes, c, candidate) ||
+        (int)candidate.vertices.size() > max_vertex)
+      break;
+    best = std::move(candidate);
+  }
+
+  double volume = fabs(get_mesh_volume(ch));
+  if (fabs(get_mesh_volume(best)) >
+      volume * (1 + std::max(0.0, max_volume_increase)))
+    return false;
+  ch = std::move(best);
+  return true;
+}
+
+void Mesh::compute_ch(Mesh &convex) const {
+  neural_acd::compute_ch(vertices, convex);
+}
+
+void Mesh::compute_vch(Mesh &convex) const {
+  neural_acd::compute_vch(vertices, convex);
+}
+
 void Mesh::extract_point_set(std::vector<Vec3D> &samples,
                              std::vector<int> &sample_tri_ids,
                              size_t resolution, double base, bool flag,
@@ -261,6 +553,8 @@ void extract_point_set(Mesh &convex1, Mesh &convex2,
 }
 
 void LoadingBar::step() {
+  if (!show_progress())
+    return;
   string bar;
   bar += "\r" + message + " [";
   int pos = (current_step * bar_length) / total_steps;
@@ -278,6 +572,8 @@ void LoadingBar::step() {
 }
 
 void LoadingBar::finish() {
+  if (!show_progress())
+    return;
   std::cout << "\r" + message + " [";
   for (int i = 0; i < bar_length; ++i) {
     if (i < bar_length)
@@ -42,6 +42,12 @@ double get_mesh_volume(Mesh &mesh) {
   return volume;
 }
 
+double compute_rv(double v1, double v2, double v3) {
+  double d = pow(3 * fabs(v1 + v2 - v3) / (4 * Pi), 1.0 / 3);
+
+  return d;
+}
+
 double compute_rv(Mesh &cvx1, Mesh &cvx2, Mesh &cvxCH, double epsilon) {
   double v1, v2, v3;
 
@@ -49,9 +55,7 @@ double compute_rv(Mesh &cvx1, Mesh &cvx2, Mesh &cvxCH, double epsilon) {
   v2 = get_mesh_volume(cvx2);
   v3 = get_mesh_volume(cvxCH);
 
-  double d = pow(3 * fabs(v1 + v2 - v3) / (4 * Pi), 1.0 / 3);
-
-  return d;
+  return compute_rv(v1, v2, v3);
 }
 
 double compute_rv(Mesh &tmesh1, Mesh &tmesh2, double epsilon) {
@@ -1,214 +1,486 @@
 #include <Eigen/Dense>
 #include <algorithm>
+#include <budget.hpp>
 #include <cmath>
 #include <core.hpp>
 #include <fstream>
 #include <iostream>
 #include <jlinkage.hpp>
+#include <kdtree.hpp>
 #include <limits>
+#include <parallel.hpp>
+#include <queue>
 #include <random>
+#include <unordered_map>
 
 using namespace std;
 
 namespace neural_acd {
+namespace detail {
+void AliasTable::build(const vector<pair<int, double>> &row) {
+  // Vose's method: scaled probabilities below 1 are topped up by one entry
+  // above 1
+  int n = row.size();
+  prob.assign(n, 1.0);
+  alias.resize(n);
+  vector<double> scaled(n);
+  vector<int> small, large;
+  for (int k = 0; k < n; ++k) {
+    alias[k] = k;
+    scaled[k] = row[k].second * n;
+    (scaled[k] < 1.0 ? small : large).push_back(k);
+  }
+  while (!small.empty() && !large.empty()) {
+    int s = small.back(), l = large.back();
+    small.pop_back();
+    prob[s] = scaled[s];
+    alias[s] = l;
+    scaled[l] -= 1.0 - scaled[s];
+    if (scaled[l] < 1.0) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // whatever is left is 1 up to rounding
+}
+
+int AliasTable::sample() const {
+  uniform_int_distribution<> pick(0, prob.size() - 1);
+  uniform_real_distribution<> coin(0.0, 1.0);
+  int k = pick(random_engine);
+  return coin(random_engine) < prob[k] ? k : alias[k];
+}
+} // namespace detail
+
 JLinkage::JLinkage(double sigma_, int num_samples_, double threshold_,
-                   int outlier_threshold_)
+                   int outlier_threshold_, double voxel_size_,
+                   int lsh_bands_, int lsh_rows_)
     : sigma(sigma_), num_samples(num_samples_), threshold(threshold_),
-      outlier_threshold(outlier_threshold_) {}
+      outlier_threshold(outlier_threshold_), voxel_size(voxel_size_),
+      lsh_bands(lsh_bands_), lsh_rows(lsh_rows_) {}
 
 void JLinkage::set_points(const vector<Vec3D> &pts) {
-  points = pts;
+  if (voxel_size > 0) {
+    downsample(pts);
+  } else {
+    points = pts;
+    full_points.clear();
+    members.clear();
+  }
   calculate_distances();
+  sample_hypotheses();
   calculate_preference_sets();
 }
 
+void JLinkage::downsample(const vector<Vec3D> &pts) {
+  full_points = pts;
+  points.clear();
+  members.clear();
+  unordered_map<uint64_t, int> voxels;
+  for (int i = 0; i < (int)pts.size(); ++i) {
+    uint64_t key = 0;
+    for (int k = 0; k < 3; ++k)
+      key = (key << 21) |
+            ((uint64_t)(int64_t)floor(pts[i][k] / voxel_size) & 0x1fffff);
+    auto it = voxels.emplace(key, (int)members.size()).first;
+    if (it->second == (int)members.size())
+      members.emplace_back();
+    members[it->second].push_back(i);
+  }
+
+  vector<pair<int, double>> weights;
+  for (auto &voxel : members) {
+    Vec3D centroid = {0.0, 0.0, 0.0};
+    for (int i : voxel)
+      centroid = centroid + pts[i];
+    points.push_back(centroid / (double)voxel.size());
+    weights.push_back({(int)weights.size(), (double)voxel.size() / pts.size()});
+  }
+  point_table.build(weights);
+}
+
 void JLinkage::calculate_distances() {
+  // The sampling kernel is only evaluated within 3 sigma of each point, which
+  // holds all but about e^-9 of its weight, and is stored as sparse rows
   int N = points.size();
-  vector<vector<double>> D(N, vector<double>(N, 0.0));
-  sample_probs = vector<vector<double>>(N, vector<double>(N, 0.0));
-
+  PointCloud<double> cloud;
+  vec2pc(cloud, points);
+  KDTree3D tree(3, cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10));
+  tree.buildIndex();
+
+  double radius = 9 * sigma * sigma; // squared, as the tree measures it
+  sample_probs.assign(N, {});
+  vector<pair<size_t, double>> found;
   for (int i = 0; i < N; ++i) {
-    double row_sum = 0.0;
-    for (int j = 0; j < N; ++j) {
-      if (i == j) {
-        D[i][j] = numeric_limits<double>::infinity();
-      } else {
-        D[i][j] = vector_length(points[i] - points[j]) *
-                  vector_length(points[i] - points[j]);
-      }
-      sample_probs[i][j] = exp(-D[i][j] / (sigma * sigma));
-      row_sum += sample_probs[i][j];
+    found.clear();
+    tree.radiusSearch(&points[i][0], radius, found,
+                      nanoflann::SearchParams(32, 0, false));
+    if (found.size() <= 1) {
+      // nothing within 3 sigma, sample the nearest point instead
+      size_t index[2];
+      double dist[2];
+      size_t n = tree.knnSearch(&points[i][0], 2, index, dist);
+      found.clear();
+      for (size_t k = 0; k < n; ++k)
+        found.push_back({index[k], dist[k]});
     }
-    for (int j = 0; j < N; ++j) {
-      sample_probs[i][j] /= row_sum;
+
+    // weights relative to the nearest neighbour, which cancels out when
+    // normalizing and keeps them from underflowing
+    double nearest = numeric_limits<double>::infinity();
+    for (auto &f : found)
+      if ((int)f.first != i)
+        nearest = min(nearest, f.second);
+    auto &row = sample_probs[i];
+    double row_sum = 0.0;
+    for (auto &f : found) {
+      if ((int)f.first == i)
+        continue;
+      double p = exp(-(f.second - nearest) / (sigma * sigma));
+      if (!members.empty())
+        p *= members[f.first].size(); // a voxel stands for its points
+      row.push_back({(int)f.first, p});
+      row_sum += p;
     }
+    sort(row.begin(), row.end());
+    for (auto &entry : row)
+      entry.second /= row_sum;
+  }
+
+  sample_tables.resize(N);
+  max_probs.assign(N, 0.0);
+  for (int i = 0; i < N; ++i) {
+    sample_tables[i].build(sample_probs[i]);
+    for (auto &entry : sample_probs[i])
+      max_probs[i] = max(max_probs[i], entry.second);
   }
 }
 
-void JLinkage::sample_triplet(int &i1, int &i2, int &i3) {
+// probability of j in the row of i, 0 if j is not a neighbour
+double JLinkage::sample_prob(int i, int j) const {
+  const auto &row = sample_probs[i];
+  auto it = lower_bound(row.begin(), row.end(), make_pair(j, 0.0));
+  return it != row.end() && it->first == j ? it->second : 0.0;
+}
+
+void JLinkage::sample_triplet(int &i1, int &i2, int &i3) const {
   uniform_int_distribution<> dis(0, points.size() - 1);
 
-  i1 = dis(random_engine);
-  discrete_distribution<> dis2(sample_probs[i1].begin(),
-                               sample_probs[i1].end());
-  i2 = dis2(random_engine);
+  i1 = members.empty() ? dis(random_engine) : point_table.sample();
+  i2 = i3 = i1; // a point without neighbours gives a degenerate triplet
+  const auto &row1 = sample_probs[i1];
+  if (row1.empty())
+    return;
+  i2 = row1[sample_tables[i1].sample()].first;
+
+  // i3 is drawn with the product of the rows of i1 and i2: a draw from the
+  // row of i1 is kept with probability p(i2, j) / max p(i2, .)
+  const int max_tries = 16;
+  uniform_real_distribution<> coin(0.0, 1.0);
+  for (int t = 0; t < max_tries; ++t) {
+    int j = row1[sample_tables[i1].sample()].first;
+    if (coin(random_engine) * max_probs[i2] < sample_prob(i2, j)) {
+      i3 = j;
+      return;
+    }
+  }
 
-  vector<double> prob3(points.size(), 0.0);
-  for (int i = 0; i < points.size(); ++i) {
-    prob3[i] = sample_probs[i1][i] * sample_probs[i2][i];
+  // the rows barely overlap, draw from their product directly
+  const auto &row2 = sample_probs[i2];
+  vector<int> candidates;
+  vector<double> weights;
+  for (size_t a = 0, b = 0; a < row1.size() && b < row2.size();) {
+    if (row1[a].first < row2[b].first) {
+      a++;
+    } else if (row2[b].first < row1[a].first) {
+      b++;
+    } else {
+      candidates.push_back(row1[a].first);
+      weights.push_back(row1[a].second * row2[b].second);
+      a++;
+      b++;
+    }
   }
-  double sum = accumulate(prob3.begin(), prob3.end(), 0.0);
-  for (auto &p : prob3)
-    p /= sum;
-  discrete_distribution<> dis3(prob3.begin(), prob3.end());
-  i3 = dis3(random_engine);
+  if (candidates.empty())
+    return;
+  discrete_distribution<> dis3(weights.begin(), weights.end());
+  i3 = candidates[dis3(random_engine)];
+}
+
+void JLinkage::sample_hypotheses() {
+  hypotheses.assign(num_samples, {});
+
+  // Hypotheses are sampled in blocks of 64, one bitset word each, as
+  // separate tasks with their own seeds. A block stopped by the time budget
+  // leaves the rest of its hypotheses invalid, and clustering uses the ones
+  // sampled so far.
+  int words = (num_samples + 63) / 64;
+  parallel_for_seeded(words, [&](int w) {
+    int end = min(num_samples, (w + 1) * 64);
+    for (int i = w * 64; i < end; ++i) {
+      if (out_of_time())
+        break;
+      int i1, i2, i3;
+      sample_triplet(i1, i2, i3);
+      Vec3D p1 = points[i1], p2 = points[i2], p3 = points[i3];
+
+      Vec3D v1 = {p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]};
+      Vec3D v2 = {p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2]};
+      Vec3D n = cross_product(v1, v2);
+      double n_norm = vector_length(n);
+      if (n_norm == 0)
+        continue;
+      for (double &c : n)
+        c /= n_norm;
+      hypotheses[i] = {n, -dot(n, p1), true};
+    }
+  });
 }
 
 void JLinkage::calculate_preference_sets() {
+  // The residuals are recomputed from the stored planes rather than kept,
+  // which would take N x num_samples doubles
   int N = points.size();
-  preference_set = detail::BoolMat(N, detail::BoolVec(num_samples, false));
-
-  for (int i = 0; i < num_samples; ++i) {
-    int i1, i2, i3;
-    sample_triplet(i1, i2, i3);
-    Vec3D p1 = points[i1], p2 = points[i2], p3 = points[i3];
-
-    Vec3D v1 = {p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]};
-    Vec3D v2 = {p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2]};
-    Vec3D n = cross_product(v1, v2);
-    double n_norm = vector_length(n);
-    if (n_norm == 0)
-      continue;
-    for (double &c : n)
-      c /= n_norm;
-    double d = -dot(n, p1);
-
-    for (int j = 0; j < N; ++j) {
-      double dist = abs(dot(points[j], n) + d);
-      if (dist < threshold) {
-        preference_set[j][i] = true;
+  int words = (num_samples + 63) / 64;
+  preference_set = detail::BitMat(N, detail::BitVec(words, 0));
+  parallel_for(words, [&](int w) {
+    int end = min(num_samples, (w + 1) * 64);
+    for (int i = w * 64; i < end; ++i) {
+      const auto &h = hypotheses[i];
+      if (!h.valid)
+        continue;
+      uint64_t bit = uint64_t(1) << (i & 63);
+      for (int j = 0; j < N; ++j) {
+        double dist = abs(dot(points[j], h.n) + h.d);
+        if (dist < threshold) {
+          preference_set[j][w] |= bit;
+        }
       }
     }
-  }
+  });
+  clustered = false;
 }
 
-double JLinkage::jaccard_distance(const detail::BoolVec &a,
-                                  const detail::BoolVec &b) {
+void JLinkage::set_threshold(double threshold_) {
+  threshold = threshold_;
+  calculate_preference_sets();
+}
+
+void JLinkage::set_outlier_threshold(int outlier_threshold_) {
+  outlier_threshold = outlier_threshold_;
+}
+
+const vector<vector<int>> &JLinkage::get_clusters() {
+  if (!clustered)
+    cluster();
+  return clusters;
+}
+
+double JLinkage::jaccard_distance(const detail::BitVec &a,
+                                  const detail::BitVec &b) {
   int intersection = 0, union_count = 0;
   for (size_t i = 0; i < a.size(); ++i) {
-    if (a[i] || b[i])
-      union_count++;
-    if (a[i] && b[i])
-      intersection++;
+    union_count += detail::popcount(a[i] | b[i]);
+    intersection += detail::popcount(a[i] & b[i]);
   }
   return 1.0 - (double)intersection / (union_count + 1e-8);
 }
 
-void print_dist_matrix(const vector<double> &dist_matrix, int N) {
-  int idx = 0;
-  for (int i = 1; i < N; ++i) {
-    for (int j = 0; j < i; ++j) {
-      cout << dist_matrix[idx] << " ";
-      idx++;
+namespace {
+// A pair of clusters, i > j, at Jaccard distance dist. Entries are not
+// removed when a cluster changes; the versions tell whether one is stale.
+struct Candidate {
+  double dist;
+  int i, j;
+  int version_i, version_j;
+
+  // the order of a scan of the condensed distance matrix, row by row
+  bool operator>(const Candidate &o) const {
+    return tie(dist, i, j) > tie(o.dist, o.i, o.j);
+  }
+};
+} // namespace
+
+vector<vector<int>> JLinkage::lsh_candidates() const {
+  int N = preference_set.size();
+  int num_hashes = lsh_bands * lsh_rows;
+
+  // MinHash signature of every preference set, hashing hypothesis x with
+  // the k-th function as task_seed(k, x)
+  vector<vector<unsigned int>> signatures(N);
+  parallel_for(N, [&](int i) {
+    const auto &prefs = preference_set[i];
+    vector<unsigned int> sig(num_hashes, numeric_limits<unsigned int>::max());
+    bool empty = true;
+    for (size_t w = 0; w < prefs.size(); ++w) {
+      for (uint64_t bits = prefs[w]; bits; bits &= bits - 1) {
+        uint64_t x = w * 64 + detail::popcount((bits & -bits) - 1);
+        for (int k = 0; k < num_hashes; ++k)
+          sig[k] = min(sig[k], task_seed(k, x));
+        empty = false;
+      }
+    }
+    if (!empty) // an empty set is at distance 1 from everything
+      signatures[i] = std::move(sig);
+  });
+
+  // Sets agreeing on every row of some band are candidates. Within a large
+  // bucket each set is only paired with the next few, which is enough for
+  // clustering to reach the rest through the merged clusters.
+  const int max_links = 32;
+  vector<vector<int>> candidates(N);
+  for (int b = 0; b < lsh_bands; ++b) {
+    unordered_map<uint64_t, vector<int>> buckets;
+    for (int i = 0; i < N; ++i) {
+      if (signatures[i].empty())
+        continue;
+      uint64_t key = b;
+      for (int r = 0; r < lsh_rows; ++r)
+        key = task_seed(key, signatures[i][b * lsh_rows + r]) ^ (key << 32);
+      buckets[key].push_back(i);
+    }
+    for (auto &bucket : buckets) {
+      const auto &sets = bucket.second;
+      for (size_t t = 0; t < sets.size(); ++t)
+        for (size_t u = t + 1; u < sets.size() && u <= t + max_links; ++u)
+          candidates[sets[u]].push_back(sets[t]);
     }
-    cout << endl;
   }
+  for (auto &list : candidates) {
+    sort(list.begin(), list.end());
+    list.erase(unique(list.begin(), list.end()), list.end());
+  }
+  return candidates;
 }
 
-vector<Plane> JLinkage::get_best_planes() {
+void JLinkage::cluster() {
   int N = preference_set.size();
-  // N = 5;
-  vector<double> dist_matrix(N * (N - 1) >> 1, 0.0);
 
-  int i1, i2;
-  for (int i = 0; i < dist_matrix.size(); ++i) {
-    i1 = (int)(sqrt(8 * i + 1) - 1) >> 1;
-    int sum = (i1 * (i1 + 1)) >> 1;
-    i2 = i - sum;
-    i1++;
-    dist_matrix[i] = jaccard_distance(preference_set[i1], preference_set[i2]);
+  // Only pairs sharing a hypothesis are closer than 1, and only those can
+  // merge. neighbours[i] lists them, sorted. In the approximate mode only
+  // the pairs found by LSH are checked.
+  bool approximate = lsh_bands > 0;
+  vector<vector<int>> candidates;
+  if (approximate)
+    candidates = lsh_candidates();
+  vector<vector<int>> neighbours(N);
+  vector<vector<double>> dists(N);
+  parallel_for(N, [&](int i) {
+    auto check = [&](int j) {
+      double d = jaccard_distance(preference_set[i], preference_set[j]);
+      if (d < 1) {
+        neighbours[i].push_back(j);
+        dists[i].push_back(d);
+      }
+    };
+    if (approximate)
+      for (int j : candidates[i])
+        check(j);
+    else
+      for (int j = 0; j < i; ++j)
+        check(j);
+  });
+  vector<vector<int>>().swap(candidates);
+
+  priority_queue<Candidate, vector<Candidate>, greater<Candidate>> heap;
+  for (int i = 0; i < N; ++i) {
+    for (size_t k = 0; k < neighbours[i].size(); ++k) {
+      int j = neighbours[i][k];
+      heap.push({dists[i][k], i, j, 0, 0});
+      neighbours[j].push_back(i);
+    }
+    vector<double>().swap(dists[i]);
   }
-  // print_dist_matrix(dist_matrix, N);
+  for (auto &list : neighbours)
+    sort(list.begin(), list.end());
 
-  vector<vector<int>> clusters(N);
+  vector<vector<int>> merged(N);
   for (int i = 0; i < N; ++i)
-    clusters[i] = {i};
-
-  LoadingBar loading_bar("Jlinkage", clusters.size());
-  while (true) {
+    merged[i] = {i};
+  vector<char> active(N, 1);
+  vector<int> version(N, 0);
+
+  LoadingBar loading_bar("Jlinkage", merged.size());
+  while (!heap.empty() && !out_of_time()) {
+    Candidate c = heap.top();
+    heap.pop();
+    if (!active[c.i] || !active[c.j] || version[c.i] != c.version_i ||
+        version[c.j] != c.version_j)
+      continue;
     loading_bar.step();
-    double min_val = numeric_limits<double>::infinity();
-    int mini = -1, minj = -1;
-
-    for (int i = 0; i < dist_matrix.size(); ++i)
-      if (dist_matrix[i] < min_val) {
-        min_val = dist_matrix[i];
-        mini = (int)(sqrt(8 * i + 1) - 1) >> 1;
-        int sum = (mini * (mini + 1)) >> 1;
-        minj = i - sum;
-        mini++;
-      }
-
-    if (min_val >= 1 || mini == -1 || minj == -1)
-      break;
-    for (size_t k = 0; k < preference_set[mini].size(); ++k)
-      preference_set[mini][k] =
-          preference_set[mini][k] && preference_set[minj][k];
-
-    clusters[mini].insert(clusters[mini].end(), clusters[minj].begin(),
-                          clusters[minj].end());
-    preference_set.erase(preference_set.begin() + minj);
-    clusters.erase(clusters.begin() + minj);
-
-    // delete column j
-    int idx = dist_matrix.size() - (N - 1) + minj; // last row, column j
-    for (int i = 0; i < N - minj - 1; ++i) {
-      dist_matrix.erase(dist_matrix.begin() + idx);
-      idx -= (N - 2 - i);
-    }
 
-    // delete row j
-    idx = (minj * (minj - 1)) >> 1; // row j, first column
-    for (int i = idx + minj - 1; i > idx - 1; --i) {
-      dist_matrix.erase(dist_matrix.begin() + i);
-    }
-
-    if (mini > minj)
-      mini--; // adjust mini if it was after minj
-
-    N--;
-    // update column i
-    idx = dist_matrix.size() - (N - 1) + mini; // last row, column i
-    for (int i = 0; i < N - mini - 1; ++i) {
-      i1 = (int)(sqrt(8 * idx + 1) - 1) >> 1;
-      int sum = (i1 * (i1 + 1)) >> 1;
-      i2 = idx - sum;
-      i1++;
-      dist_matrix[idx] =
-          jaccard_distance(preference_set[i1], preference_set[i2]);
-      idx -= (N - 2 - i);
+    // i keeps its place and takes in j
+    int i = c.i, j = c.j;
+    for (size_t k = 0; k < preference_set[i].size(); ++k)
+      preference_set[i][k] &= preference_set[j][k];
+    merged[i].insert(merged[i].end(), merged[j].begin(), merged[j].end());
+    active[j] = 0;
+    version[i]++;
+    detail::BitVec().swap(preference_set[j]);
+    vector<int>().swap(merged[j]);
+
+    // What the merged cluster shares, both of its halves shared. With
+    // incomplete neighbour lists, anything either half is known to share is
+    // checked instead.
+    vector<int> common;
+    if (approximate)
+      set_union(neighbours[i].begin(), neighbours[i].end(),
+                neighbours[j].begin(), neighbours[j].end(),
+                back_inserter(common));
+    else
+      set_intersection(neighbours[i].begin(), neighbours[i].end(),
+                       neighbours[j].begin(), neighbours[j].end(),
+                       back_inserter(common));
+    vector<int>().swap(neighbours[j]);
+    neighbours[i].clear();
+    for (int k : common) {
+      if (!active[k] || k == i || k == j)
+        continue;
+      double d = jaccard_distance(preference_set[i], preference_set[k]);
+      if (d >= 1)
+        continue;
+      neighbours[i].push_back(k);
+      // k may only have known one of the halves
+      auto &back = neighbours[k];
+      auto at = lower_bound(back.begin(), back.end(), i);
+      if (at == back.end() || *at != i)
+        back.insert(at, i);
+      if (i > k)
+        heap.push({d, i, k, version[i], version[k]});
+      else
+        heap.push({d, k, i, version[k], version[i]});
     }
+  }
+  loading_bar.finish();
 
-    // update row i
-    idx = (mini * (mini - 1)) >> 1; // row i, first column
-    for (int i = idx; i < idx + mini; ++i) {
-      i1 = (int)(sqrt(8 * i + 1) - 1) >> 1;
-      int sum = (i1 * (i1 + 1)) >> 1;
-      i2 = i - sum;
-      i1++;
-      dist_matrix[i] = jaccard_distance(preference_set[i1], preference_set[i2]);
+  clusters.clear();
+  for (int i = 0; i < N; ++i) {
+    if (!active[i])
+      continue;
+    if (members.empty()) {
+      clusters.push_back(std::move(merged[i]));
+      continue;
     }
-
-    // print_dist_matrix(dist_matrix, N);
+    // planes are refitted to the points in the clustered voxels
+    vector<int> full;
+    for (int v : merged[i])
+      full.insert(full.end(), members[v].begin(), members[v].end());
+    clusters.push_back(std::move(full));
   }
-  loading_bar.finish();
-  vector<Plane> planes = cluster_planes(clusters);
-  cout << "Found " << planes.size() << " planes" << endl;
+  clustered = true;
+}
 
+vector<Plane> JLinkage::get_best_planes() {
+  vector<Plane> planes = cluster_planes(get_clusters());
+  if (show_progress())
+    cout << "Found " << planes.size() << " planes" << endl;
   return planes;
 }
 
-vector<Plane> JLinkage::cluster_planes(vector<vector<int>> &clusters) {
+
+vector<Plane> JLinkage::cluster_planes(const vector<vector<int>> &clusters) {
+  // the input points, also when sampling used voxels
+  const vector<Vec3D> &pts = members.empty() ? points : full_points;
   vector<Plane> planes;
   for (auto &cluster : clusters) {
     if (cluster.size() < outlier_threshold)
@@ -217,15 +489,15 @@ vector<Plane> JLinkage::cluster_planes(vector<vector<int>> &clusters) {
     Vec3D centroid = {0.0, 0.0, 0.0};
     for (int idx : cluster)
       for (int j = 0; j < 3; ++j)
-        centroid[j] += points[idx][j];
+        centroid[j] += pts[idx][j];
     for (int j = 0; j < 3; ++j)
       centroid[j] /= cluster.size();
 
     Eigen::MatrixXd centered(cluster.size(), 3);
     for (int i = 0; i < cluster.size(); ++i) {
-      centered(i, 0) = points[cluster[i]][0] - centroid[0];
-      centered(i, 1) = points[cluster[i]][1] - centroid[1];
-      centered(i, 2) = points[cluster[i]][2] - centroid[2];
+      centered(i, 0) = pts[cluster[i]][0] - centroid[0];
+      centered(i, 1) = pts[cluster[i]][1] - centroid[1];
+      centered(i, 2) = pts[cluster[i]][2] - centroid[2];
     }
 
     Eigen::JacobiSVD<Eigen::MatrixXd> svd(centered, Eigen::ComputeThinU |
@@ -0,0 +1,19 @@
+#include <config.hpp>
+#include <jlinkage.hpp>
+#include <plane_extractor.hpp>
+#include <ransac.hpp>
+
+namespace neural_acd {
+std::unique_ptr<PlaneExtractor> make_plane_extractor() {
+  if (config.plane_fit == PLANE_FIT_RANSAC)
+    return std::make_unique<Ransac>(
+        config.jlinkage_threshold, config.jlinkage_outlier_threshold,
+        config.ransac_max_iterations, config.ransac_normal_angle,
+        config.ransac_neighbours);
+  return std::make_unique<JLinkage>(
+      config.jlinkage_sigma, config.jlinkage_num_samples,
+      config.jlinkage_threshold, config.jlinkage_outlier_threshold,
+      config.jlinkage_voxel_ratio * config.jlinkage_threshold,
+      config.jlinkage_lsh_bands, config.jlinkage_lsh_rows);
+}
+} // namespace neural_acd
\ No newline at end of file
@@ -1,17 +1,32 @@
 #include <algorithm>
+#include <budget.hpp>
+#include <chrono>
 #include <clip.hpp>
+#include <cmath>
 #include <config.hpp>
 #include <core.hpp>
 #include <cost.hpp>
+#include <ctime>
 #include <fstream>
 #include <iostream>
-#include <jlinkage.hpp>
+#include <kdtree.hpp>
+#include <limits>
 #include <map>
+#include <memory>
+#include <metrics.hpp>
+#include <optional>
+#include <parallel.hpp>
+#include <plane_extractor.hpp>
 #include <preprocess.hpp>
 #include <process.hpp>
-#include <queue>
+#include <stdexcept>
 #include <unordered_map>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
 using namespace std;
 
 namespace neural_acd {
@@ -31,21 +46,6 @@ int32_t find_min_element(const std::vector<double> d, double *const m,
   return idx;
 }
 
-void merge_ch(Mesh &ch1, Mesh &ch2, Mesh &ch) {
-  Mesh merge;
-  merge.vertices.insert(merge.vertices.end(), ch1.vertices.begin(),
-                        ch1.vertices.end());
-  merge.vertices.insert(merge.vertices.end(), ch2.vertices.begin(),
-                        ch2.vertices.end());
-  merge.triangles.insert(merge.triangles.end(), ch1.triangles.begin(),
-                         ch1.triangles.end());
-  for (int i = 0; i < (int)ch2.triangles.size(); i++)
-    merge.triangles.push_back({int(ch2.triangles[i][0] + ch1.vertices.size()),
-                               int(ch2.triangles[i][1] + ch1.vertices.size()),
-                               int(ch2.triangles[i][2] + ch1.vertices.size())});
-  merge.compute_ch(ch);
-}
-
 void print_cost_mtx(const vector<double> &costMatrix) {
   for (size_t i = 0; i < costMatrix.size(); ++i) {
     if (costMatrix[i] == INF)
@@ -56,10 +56,24 @@ void print_cost_mtx(const vector<double> &costMatrix) {
   cout << endl;
 }
 
-double multimerge_ch(Mesh &m, MeshList &meshs, MeshList &cvxs,
-                     double threshold) {
+// index of the pair (i, j), i > j, in the condensed upper half of a matrix
+inline size_t pair_index(size_t i, size_t j) {
+  if (i < j)
+    std::swap(i, j);
+  return ((i * (i - 1)) >> 1) + j;
+}
+
+// with a tree, merges down to one hull and records every step in it
+double multimerge_ch(MeshList &cvxs, double threshold, const PartGraph &graph,
+                     MergeTree *tree = nullptr) {
   size_t nConvexHulls = (size_t)cvxs.size();
+  bool use_graph = config.merge_part_graph && !graph.empty();
   double h = 0;
+  if (tree) {
+    tree->num_leaves = nConvexHulls;
+    tree->nodes = cvxs;
+    tree->steps.clear();
+  }
 
   if (nConvexHulls > 1) {
     int bound = ((((nConvexHulls - 1) * nConvexHulls)) >> 1);
@@ -67,7 +81,58 @@ double multimerge_ch(Mesh &m, MeshList &meshs, MeshList &cvxs,
     vector<double> costMatrix;
     costMatrix.resize(bound); // only keeps the top half of the matrix
 
+    // merge candidates, either the part adjacency recorded while clipping or
+    // every pair of hulls closer than the threshold. Hulls without an edge,
+    // such as components that never touched a cut, keep the distance test.
+    vector<char> adjacency, linked(nConvexHulls, 0);
+    if (use_graph) {
+      adjacency.resize(bound, 0);
+      for (const auto &edge : graph)
+        if (edge.part1 != edge.part2) {
+          adjacency[pair_index(edge.part1, edge.part2)] = 1;
+          linked[edge.part1] = linked[edge.part2] = 1;
+        }
+    }
+
+    // hulls evaluated as merge candidates, keyed by the ids of the two input
+    // hulls, so that the winning merge does not recompute its hull
+    vector<uint64_t> ids(nConvexHulls);
+    vector<double> volumes(nConvexHulls);
+    for (size_t i = 0; i < nConvexHulls; ++i) {
+      ids[i] = i;
+      volumes[i] = get_mesh_volume(cvxs[i]);
+    }
+    uint64_t next_id = nConvexHulls;
+    unordered_map<uint64_t, Mesh> merged_cache;
+    auto cache_key = [&](size_t i, size_t j) {
+      return (min(ids[i], ids[j]) << 32) | max(ids[i], ids[j]);
+    };
+    // merge in id order, so a cached hull matches a recomputed one
+    auto merge_pair = [&](size_t i, size_t j, Mesh &ch) {
+      if (ids[i] > ids[j])
+        swap(i, j);
+      merge_ch(cvxs[i], cvxs[j], ch);
+    };
+
+    // set once the candidates run out with more than config.max_parts hulls
+    // left; from then on every pair is a candidate
+    bool all_pairs = false;
+    auto pair_cost = [&](size_t i, size_t j) {
+      if (!all_pairs && !(use_graph && adjacency[pair_index(i, j)]) &&
+          ((use_graph && linked[i] && linked[j]) ||
+           mesh_dist(cvxs[i], cvxs[j]) >= threshold))
+        return INF;
+      Mesh combinedCH;
+      merge_pair(i, j, combinedCH);
+      double cost =
+          compute_rv(volumes[i], volumes[j], get_mesh_volume(combinedCH));
+      if (merged_cache.size() < (size_t)config.merge_cache_size)
+        merged_cache[cache_key(i, j)] = std::move(combinedCH);
+      return cost;
+    };
+
     size_t p1, p2;
+    bool stopped = false;
     for (int idx = 0; idx < bound; ++idx) {
       p1 = (int)(sqrt(8 * idx + 1) - 1) >>
            1; // compute nearest triangle number index
@@ -75,19 +140,13 @@ double multimerge_ch(Mesh &m, MeshList &meshs, MeshList &cvxs,
           (p1 * (p1 + 1)) >> 1; // compute nearest triangle number from index
       p2 = idx - sum;           // modular arithmetic from triangle number
       p1++;
-      double dist = mesh_dist(cvxs[p1], cvxs[p2]);
-      if (dist < threshold) {
-        Mesh combinedCH;
-        merge_ch(cvxs[p1], cvxs[p2], combinedCH);
-
-        costMatrix[idx] = compute_rv(cvxs[p1], cvxs[p2], combinedCH);
-      } else {
-        costMatrix[idx] = INF;
-      }
+      // past the budget the remaining pairs are left out
+      stopped = stopped || out_of_time();
+      costMatrix[idx] = stopped ? INF : pair_cost(p1, p2);
     }
 
     size_t costSize = (size_t)cvxs.size();
-    while (true) {
+    while (!out_of_time()) {
       // print_cost_mtx(costMatrix);
       // Search for lowest cost
       double bestCost = INF;
@@ -97,14 +156,29 @@ double multimerge_ch(Mesh &m, MeshList &meshs, MeshList &cvxs,
       // std::cout << "best cost: " << bestCost << " at addr: " << addr
       //           << std::endl;
 
+      // past the threshold, merging goes on only to reach config.max_parts
+      bool over_cap =
+          tree ? cvxs.size() > 1
+               : config.max_parts > 0 && cvxs.size() > (size_t)config.max_parts;
+      if (addr < 0 && over_cap && !all_pairs) {
+        all_pairs = true;
+        for (size_t i = 1; i < costSize; ++i)
+          for (size_t j = 0; j < i; ++j) {
+            stopped = stopped || out_of_time();
+            costMatrix[pair_index(i, j)] = stopped ? INF : pair_cost(i, j);
+          }
+        continue;
+      }
+
       if (addr < 0) {
         break;
       }
 
-      if (bestCost > threshold)
+      if (bestCost > threshold && !over_cap)
         break;
 
       h = max(h, bestCost);
+      count_event(&MetricsCounters::merge_iterations);
       const size_t addrI =
           (static_cast<int32_t>(sqrt(1 + (8 * addr))) - 1) >> 1;
       const size_t p1 = addrI + 1;
@@ -114,157 +188,187 @@ double multimerge_ch(Mesh &m, MeshList &meshs, MeshList &cvxs,
 
       // Make the lowest cost row and column into a new hull
       Mesh cch;
-      merge_ch(cvxs[p1], cvxs[p2], cch);
-      cvxs[p2] = cch;
+      auto cached = merged_cache.find(cache_key(p1, p2));
+      if (cached != merged_cache.end())
+        cch = std::move(cached->second);
+      else
+        merge_pair(p1, p2, cch);
+
+      if (tree) {
+        tree->steps.push_back(
+            {(int)ids[p1], (int)ids[p2], bestCost, all_pairs});
+        tree->nodes.push_back(cch);
+      }
+
+      // candidates involving the two merged hulls are stale
+      for (auto it = merged_cache.begin(); it != merged_cache.end();) {
+        uint64_t id1 = it->first >> 32, id2 = it->first & 0xffffffff;
+        if (id1 == ids[p1] || id1 == ids[p2] || id2 == ids[p1] ||
+            id2 == ids[p2])
+          it = merged_cache.erase(it);
+        else
+          ++it;
+      }
+
+      cvxs[p2] = std::move(cch);
+      volumes[p2] = get_mesh_volume(cvxs[p2]);
+      ids[p2] = next_id++;
+
+      // the merged hull inherits the neighbours of both hulls
+      if (use_graph)
+        for (size_t i = 0; i < costSize; ++i)
+          if (i != p1 && i != p2)
+            adjacency[pair_index(p2, i)] |= adjacency[pair_index(p1, i)];
+      linked[p2] |= linked[p1];
 
       swap(cvxs[p1], cvxs[cvxs.size() - 1]);
       cvxs.pop_back();
+      swap(volumes[p1], volumes[volumes.size() - 1]);
+      volumes.pop_back();
+      swap(ids[p1], ids[ids.size() - 1]);
+      ids.pop_back();
+      swap(linked[p1], linked[linked.size() - 1]);
+      linked.pop_back();
 
       costSize = costSize - 1;
 
-      // Calculate costs versus the new hull
-      size_t rowIdx = ((p2 - 1) * p2) >> 1;
-      for (size_t i = 0; (i < p2); ++i) {
-        double dist = mesh_dist(cvxs[p2], cvxs[i]);
-        if (dist < threshold) {
-          Mesh combinedCH;
-          merge_ch(cvxs[p2], cvxs[i], combinedCH);
-          costMatrix[rowIdx++] = compute_rv(cvxs[p2], cvxs[i], combinedCH);
-        } else
-          costMatrix[rowIdx++] = INF;
-      }
-
-      rowIdx += p2;
-      for (size_t i = p2 + 1; (i < costSize); ++i) {
-        double dist = mesh_dist(cvxs[p2], cvxs[i]);
-        if (dist < threshold) {
-          Mesh combinedCH;
-          merge_ch(cvxs[p2], cvxs[i], combinedCH);
-          costMatrix[rowIdx] = compute_rv(cvxs[p2], cvxs[i], combinedCH);
-        } else
-          costMatrix[rowIdx] = INF;
-        rowIdx += i;
-      }
-
-      // Move the top column in to replace its space
+      // Move the last row and column in to replace the space of p1
       const size_t erase_idx = ((costSize - 1) * costSize) >> 1;
       if (p1 < costSize) {
-        rowIdx = (addrI * p1) >> 1;
-        size_t top_row = erase_idx;
-        for (size_t i = 0; i < p1; ++i) {
-          if (i != p2) {
-            costMatrix[rowIdx] = costMatrix[top_row];
-          }
-          ++rowIdx;
-          ++top_row;
-        }
-
-        ++top_row;
-        rowIdx += p1;
-        for (size_t i = p1 + 1; i < costSize; ++i) {
-          costMatrix[rowIdx] = costMatrix[top_row];
-          rowIdx += i;
+        for (size_t i = 0; i < costSize; ++i) {
+          if (i == p1)
+            continue;
+          costMatrix[pair_index(p1, i)] = costMatrix[pair_index(costSize, i)];
+          if (use_graph)
+            adjacency[pair_index(p1, i)] = adjacency[pair_index(costSize, i)];
         }
       }
       costMatrix.resize(erase_idx);
+      if (use_graph)
+        adjacency.resize(erase_idx);
+
+      // Calculate costs versus the new hull
+      for (size_t i = 0; i < costSize; ++i)
+        if (i != p2)
+          costMatrix[pair_index(p2, i)] = pair_cost(p2, i);
     }
   }
 
   return h;
 }
 
+int find_root(vector<int> &parent, int x) {
+  while (parent[x] != x) {
+    parent[x] = parent[parent[x]]; // path halving
+    x = parent[x];
+  }
+  return x;
+}
+
 MeshList separate_disjoint_step(Mesh &part) {
   if (part.triangles.empty()) {
     return {};
   }
 
-  map<pair<int, int>, vector<int>> edge_map; // edge -> connected tris
+  const int nt = (int)part.triangles.size();
 
-  auto make_edge = [](int a, int b) {
-    return std::pair<int, int>{std::min(a, b), std::max(a, b)};
-  };
-
-  // Build edge to triangle map
-  for (int i = 0; i < part.triangles.size(); ++i) {
+  // every edge as (sorted vertex pair, triangle); triangles sharing an edge
+  // end up next to each other after sorting
+  vector<pair<uint64_t, int>> edges;
+  edges.reserve(3 * nt);
+  for (int i = 0; i < nt; ++i) {
     const auto &tri = part.triangles[i];
-    pair<int, int> e1 = make_edge(tri[0], tri[1]);
-    pair<int, int> e2 = make_edge(tri[1], tri[2]);
-    pair<int, int> e3 = make_edge(tri[0], tri[2]);
-
-    edge_map[e1].push_back(i);
-    edge_map[e2].push_back(i);
-    edge_map[e3].push_back(i);
+    for (int k = 0; k < 3; ++k) {
+      uint64_t a = (uint32_t)tri[k], b = (uint32_t)tri[(k + 1) % 3];
+      if (a > b)
+        swap(a, b);
+      edges.push_back({(a << 32) | b, i});
+    }
   }
+  sort(edges.begin(), edges.end());
 
-  unordered_map<int, int> tri_to_part; // triangle index -> part number
-  int part_num = 0;
-
-  // Flood fill to find connected components
-  for (int i = 0; i < part.triangles.size(); ++i) {
-    if (tri_to_part.count(i)) {
+  // union-find over triangles connected through an edge
+  vector<int> parent(nt);
+  for (int i = 0; i < nt; ++i)
+    parent[i] = i;
+  for (size_t e = 1; e < edges.size(); ++e) {
+    if (edges[e].first != edges[e - 1].first)
       continue;
-    }
-
-    queue<int> q;
-    q.push(i);
-    tri_to_part[i] = part_num;
-
-    while (!q.empty()) {
-      int cur = q.front();
-      q.pop();
+    int r1 = find_root(parent, edges[e].second);
+    int r2 = find_root(parent, edges[e - 1].second);
+    if (r1 != r2)
+      parent[max(r1, r2)] = min(r1, r2);
+  }
 
-      const auto &tri = part.triangles[cur];
-      pair<int, int> edges[3] = {make_edge(tri[0], tri[1]),
-                                 make_edge(tri[1], tri[2]),
-                                 make_edge(tri[0], tri[2])};
+  // parts are numbered by their first triangle
+  vector<int> tri_to_part(nt);
+  vector<int> root_to_part(nt, -1);
+  int part_num = 0;
+  for (int i = 0; i < nt; ++i) {
+    int r = find_root(parent, i);
+    if (root_to_part[r] < 0)
+      root_to_part[r] = part_num++;
+    tri_to_part[i] = root_to_part[r];
+  }
 
-      for (const auto &edge : edges) {
-        for (int neighbor : edge_map[edge]) {
-          if (neighbor != cur && !tri_to_part.count(neighbor)) {
-            tri_to_part[neighbor] = part_num;
-            q.push(neighbor);
-          }
-        }
-      }
-    }
-    part_num++;
+  // counting sort of the triangles by part, keeping their order in each part
+  vector<int> offsets(part_num + 1, 0);
+  for (int i = 0; i < nt; ++i)
+    offsets[tri_to_part[i] + 1]++;
+  for (int p = 0; p < part_num; ++p)
+    offsets[p + 1] += offsets[p];
+  vector<int> order(nt);
+  {
+    vector<int> pos(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < nt; ++i)
+      order[pos[tri_to_part[i]]++] = i;
   }
 
   // Create new meshes for each part
   MeshList new_parts(part_num);
-  vector<unordered_map<int, int>> vertex_remap(part_num); // global v -> part v
-
-  for (int i = 0; i < part.triangles.size(); ++i) {
-    int part_idx = tri_to_part[i];
-    Mesh &current_part = new_parts[part_idx];
-    const auto &tri = part.triangles[i];
-
-    // Remap vertices
-    array<int, 3> new_indices;
-    for (int k = 0; k < 3; ++k) {
-      int global_v = tri[k];
-      auto &remap = vertex_remap[part_idx];
-
-      if (!remap.count(global_v)) {
-        remap[global_v] = current_part.vertices.size();
-        current_part.vertices.push_back(part.vertices[global_v]);
+  vector<int> remap_part(part.vertices.size(), -1); // last part using vertex
+  vector<int> remap(part.vertices.size());          // global v -> part v
+  for (int p = 0; p < part_num; ++p) {
+    Mesh &current_part = new_parts[p];
+    current_part.triangles.reserve(offsets[p + 1] - offsets[p]);
+    for (int o = offsets[p]; o < offsets[p + 1]; ++o) {
+      const auto &tri = part.triangles[order[o]];
+      array<int, 3> new_indices;
+      for (int k = 0; k < 3; ++k) {
+        int global_v = tri[k];
+        if (remap_part[global_v] != p) {
+          remap_part[global_v] = p;
+          remap[global_v] = current_part.vertices.size();
+          current_part.vertices.push_back(part.vertices[global_v]);
+        }
+        new_indices[k] = remap[global_v];
       }
-      new_indices[k] = remap[global_v];
+      current_part.triangles.push_back(new_indices);
     }
-
-    current_part.triangles.push_back(new_indices);
   }
   return new_parts;
 }
 
-void separate_disjoint(MeshList &parts) {
+void separate_disjoint(MeshList &parts, PartGraph &graph) {
+  vector<MeshList> res(parts.size());
+  parallel_for((int)parts.size(),
+               [&](int i) { res[i] = separate_disjoint_step(parts[i]); });
+
   MeshList new_parts;
-  for (auto &part : parts) {
-    MeshList res = separate_disjoint_step(part);
-    new_parts.insert(new_parts.end(), res.begin(), res.end());
+  vector<vector<int>> children(parts.size());
+  for (int i = 0; i < (int)parts.size(); ++i) {
+    for (auto &r : res[i]) {
+      children[i].push_back(new_parts.size());
+      new_parts.push_back(std::move(r));
+    }
   }
-  parts.clear();
-  parts.insert(parts.end(), new_parts.begin(), new_parts.end());
+  graph = remap_part_graph(graph, children, new_parts);
+  parts = std::move(new_parts);
+}
+
+void separate_disjoint(MeshList &parts) {
+  PartGraph graph;
+  separate_disjoint(parts, graph);
 }
 
 void write_stats(std::string stats_file, double concavity, int n_parts) {
@@ -275,67 +379,799 @@ void write_stats(std::string stats_file, double concavity, int n_parts) {
   f.close();
 }
 
-MeshList process(Mesh mesh, vector<Vec3D> cut_points, std::string stats_file) {
-  // cout << cut_points.size() << " cut points provided." << endl;
+// every stage run_process may record, in the order it runs them. CSV rows
+// have a column group for each, left empty if the stage did not run, so that
+// rows of runs with different configs line up.
+const char *const csv_stages[] = {
+    "normalize", "fit_planes", "clip", "separate", "hulls", "refine",
+    "part_concavity", "emit_isolated", "merge", "simplify", "emit", "remesh",
+    "concavity"};
+
+void write_csv_metrics(ofstream &f, const ProcessResult &result,
+                       bool header) {
+  const Metrics &m = result.metrics;
+  if (header) {
+    f << "input_vertices,input_triangles,cut_points,planes,clip_calls,"
+         "clips_skipped,cdt_failures,vch_fallbacks,merge_iterations,"
+         "peak_parts,max_hull_vertices,hulls_over_vertex_limit,budget_stops,"
+         "parts,concavity";
+    for (const char *name : csv_stages)
+      f << "," << name << "_wall," << name << "_cpu," << name << "_items,"
+        << name << "_truncated";
+    f << "\n";
+  }
+  f << m.input_vertices << "," << m.input_triangles << "," << m.cut_points
+    << "," << m.planes << "," << m.clip_calls << "," << m.clips_skipped << ","
+    << m.cdt_failures << "," << m.vch_fallbacks << "," << m.merge_iterations
+    << "," << m.peak_parts << "," << m.max_hull_vertices << ","
+    << m.hulls_over_vertex_limit << "," << m.budget_stops << ","
+    << m.output_hulls << ","
+    << result.concavity;
+  for (const char *name : csv_stages) {
+    auto stage = find_if(result.stages.begin(), result.stages.end(),
+                         [&](const StageStats &s) { return s.name == name; });
+    if (stage == result.stages.end())
+      f << ",,,,";
+    else
+      f << "," << stage->wall_time << "," << stage->cpu_time << ","
+        << stage->items << "," << stage->truncated;
+  }
+  f << "\n";
+}
+
+void write_json_metrics(ofstream &f, const ProcessResult &result) {
+  const Metrics &m = result.metrics;
+  f << "{\"input_vertices\": " << m.input_vertices
+    << ", \"input_triangles\": " << m.input_triangles
+    << ", \"cut_points\": " << m.cut_points << ", \"planes\": " << m.planes
+    << ", \"clip_calls\": " << m.clip_calls
+    << ", \"clips_skipped\": " << m.clips_skipped
+    << ", \"cdt_failures\": " << m.cdt_failures
+    << ", \"vch_fallbacks\": " << m.vch_fallbacks
+    << ", \"merge_iterations\": " << m.merge_iterations
+    << ", \"peak_parts\": " << m.peak_parts
+    << ", \"max_hull_vertices\": " << m.max_hull_vertices
+    << ", \"hulls_over_vertex_limit\": " << m.hulls_over_vertex_limit
+    << ", \"budget_stops\": " << m.budget_stops
+    << ", \"parts\": " << m.output_hulls << ", \"concavity\": ";
+  if (std::isnan(result.concavity))
+    f << "null"; // NaN is not valid JSON
+  else
+    f << result.concavity;
+  f << ", \"stages\": [";
+  for (size_t i = 0; i < result.stages.size(); i++) {
+    const StageStats &stage = result.stages[i];
+    f << (i ? ", " : "") << "{\"name\": \"" << stage.name
+      << "\", \"wall_time\": " << stage.wall_time
+      << ", \"cpu_time\": " << stage.cpu_time
+      << ", \"items\": " << stage.items
+      << ", \"truncated\": " << (stage.truncated ? "true" : "false") << "}";
+  }
+  f << "]}\n";
+}
+
+void write_metrics(std::string metrics_file, const ProcessResult &result) {
+  bool json = metrics_file.size() >= 5 &&
+              metrics_file.compare(metrics_file.size() - 5, 5, ".json") == 0;
+  bool header = !ifstream(metrics_file).good();
+  ofstream f(metrics_file, ios::app);
+  f.precision(10);
+  if (json)
+    write_json_metrics(f, result);
+  else
+    write_csv_metrics(f, result, header);
+  f.close();
+}
+
+double thread_cpu_time() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+  auto ticks = [](const FILETIME &t) {
+    return (double)(((uint64_t)t.dwHighDateTime << 32) | t.dwLowDateTime);
+  };
+  return (ticks(kernel) + ticks(user)) * 1e-7; // 100 ns ticks
+#else
+  timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+long budget_stops() {
+  return current_counters ? current_counters->budget_stops.load() : 0;
+}
+
+// CPU seconds of this thread plus those its parallel_for workers reported,
+// so that runs next to each other in process_batch do not count each other
+double run_cpu_time() {
+  double t = thread_cpu_time();
+  if (current_counters)
+    t += current_counters->worker_cpu_ns * 1e-9;
+  return t;
+}
+
+class StageTimer {
+public:
+  StageTimer()
+      : wall_start(chrono::steady_clock::now()), cpu_start(run_cpu_time()),
+        stops_start(budget_stops()) {}
+  void finish(vector<StageStats> &stages, const std::string &name,
+              int items) {
+    StageStats stage;
+    stage.name = name;
+    stage.wall_time = chrono::duration<double>(chrono::steady_clock::now() -
+                                               wall_start)
+                          .count();
+    stage.cpu_time = run_cpu_time() - cpu_start;
+    stage.items = items;
+    stage.truncated = budget_stops() > stops_start;
+    stages.push_back(stage);
+  }
+
+private:
+  chrono::steady_clock::time_point wall_start;
+  double cpu_start;
+  long stops_start;
+};
 
+void normalize_input(Mesh &mesh, vector<Vec3D> &cut_points) {
   mesh.normalize(cut_points); // normalize the mesh and cut points
+}
 
-  MeshList parts;
-  if (cut_points.size() != 0) {
+// groups of points linked by chains of neighbours closer than radius, in the
+// order of their first point
+vector<vector<int>> linked_groups(const vector<Vec3D> &points, double radius) {
+  int N = points.size();
+  PointCloud<double> cloud;
+  vec2pc(cloud, points);
+  KDTree3D tree(3, cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10));
+  tree.buildIndex();
 
-    JLinkage jlinkage(config.jlinkage_sigma, config.jlinkage_num_samples,
-                      config.jlinkage_threshold,
-                      config.jlinkage_outlier_threshold);
-    jlinkage.set_points(cut_points);
-    vector<Plane> planes = jlinkage.get_best_planes();
+  vector<int> parent(N);
+  for (int i = 0; i < N; i++)
+    parent[i] = i;
+  vector<pair<size_t, double>> found;
+  for (int i = 0; i < N; i++) {
+    found.clear();
+    tree.radiusSearch(&points[i][0], radius * radius, found,
+                      nanoflann::SearchParams(32, 0, false));
+    for (auto &f : found) {
+      int a = find_root(parent, i), b = find_root(parent, (int)f.first);
+      if (a != b)
+        parent[max(a, b)] = min(a, b);
+    }
+  }
 
-    if (planes.empty()) {
-      parts.push_back(mesh);
-    } else {
-      parts = multiclip(mesh, planes);
+  vector<vector<int>> groups;
+  vector<int> group(N, -1);
+  for (int i = 0; i < N; i++) {
+    int root = find_root(parent, i);
+    if (group[root] < 0) {
+      group[root] = groups.size();
+      groups.emplace_back();
     }
+    groups[group[root]].push_back(i);
+  }
+  return groups;
+}
 
-  } else {
-    parts.push_back(mesh);
+vector<Plane> fit_planes_once(const vector<Vec3D> &cut_points) {
+  unique_ptr<PlaneExtractor> extractor = make_plane_extractor();
+  extractor->set_points(cut_points);
+  return extractor->get_best_planes();
+}
+
+vector<Plane> fit_planes(const vector<Vec3D> &cut_points) {
+  if (cut_points.empty())
+    return {};
+  if (config.jlinkage_partition_ratio <= 0)
+    return fit_planes_once(cut_points);
+
+  // Points further apart than the radius are never sampled together, so
+  // each linked group is fitted on its own. Groups too small to give a plane
+  // are dropped.
+  vector<vector<int>> groups = linked_groups(
+      cut_points, config.jlinkage_partition_ratio * config.jlinkage_sigma);
+  groups.erase(remove_if(groups.begin(), groups.end(),
+                         [](const vector<int> &g) {
+                           return (int)g.size() <
+                                  config.jlinkage_outlier_threshold;
+                         }),
+               groups.end());
+  vector<vector<Plane>> group_planes(groups.size());
+  parallel_for_seeded((int)groups.size(), [&](int g) {
+    vector<Vec3D> points;
+    for (int i : groups[g])
+      points.push_back(cut_points[i]);
+    group_planes[g] = fit_planes_once(points);
+  });
+
+  vector<Plane> planes;
+  for (auto &p : group_planes)
+    planes.insert(planes.end(), p.begin(), p.end());
+  // the groups fitted on workers print nothing themselves
+  if (show_progress())
+    cout << "Found " << planes.size() << " planes in " << groups.size()
+         << " groups" << endl;
+  return planes;
+}
+
+// Hull of a part. Every part needs one, so past the budget the hull of its
+// bounding box stands in.
+void compute_part_ch(const Mesh &part, Mesh &convex) {
+  if (part.vertices.empty() || !out_of_time()) {
+    part.compute_ch(convex);
+    return;
   }
-  separate_disjoint(parts);
-  MeshList cvxs;
-  for (auto &part : parts) {
-    Mesh ch;
-    part.compute_ch(ch);
-    cvxs.push_back(ch);
-    double h = compute_h(part, ch, config.cost_rv_k, config.pcd_res);
-    // cout << h << endl;
+  Vec3D lo = {INF, INF, INF}, hi = {-INF, -INF, -INF};
+  for (auto &v : part.vertices)
+    for (int k = 0; k < 3; k++) {
+      lo[k] = min(lo[k], v[k]);
+      hi[k] = max(hi[k], v[k]);
+    }
+  vector<Vec3D> corners;
+  for (int c = 0; c < 8; c++)
+    corners.push_back({c & 1 ? hi[0] : lo[0], c & 2 ? hi[1] : lo[1],
+                       c & 4 ? hi[2] : lo[2]});
+  compute_ch(corners, convex);
+}
+
+MeshList compute_hulls(const MeshList &parts) {
+  MeshList cvxs(parts.size());
+  parallel_for((int)parts.size(),
+               [&](int i) { compute_part_ch(parts[i], cvxs[i]); });
+  return cvxs;
+}
+
+// cut points within the inlier distance of the part's bounding box
+vector<Vec3D> cut_points_near(const Mesh &part,
+                              const vector<Vec3D> &cut_points) {
+  Vec3D lo = {INF, INF, INF}, hi = {-INF, -INF, -INF};
+  for (auto &v : part.vertices)
+    for (int k = 0; k < 3; k++) {
+      lo[k] = min(lo[k], v[k] - config.jlinkage_threshold);
+      hi[k] = max(hi[k], v[k] + config.jlinkage_threshold);
+    }
+  vector<Vec3D> near;
+  for (auto &p : cut_points)
+    if (p[0] >= lo[0] && p[0] <= hi[0] && p[1] >= lo[1] && p[1] <= hi[1] &&
+        p[2] >= lo[2] && p[2] <= hi[2])
+      near.push_back(p);
+  return near;
+}
+
+int max_plane_id(const PartGraph &graph) {
+  int id = -1;
+  for (const auto &edge : graph)
+    id = max(id, edge.plane_id);
+  return id;
+}
+
+// Appends pieces, and their graph with the part and plane ids shifted past
+// those already in parts and graph. children receives the new part indices.
+void append_pieces(MeshList &parts, PartGraph &graph, vector<int> &children,
+                   MeshList &pieces, const PartGraph &piece_graph,
+                   int &next_plane_id) {
+  int offset = parts.size();
+  for (auto &piece : pieces) {
+    children.push_back(parts.size());
+    parts.push_back(std::move(piece));
+  }
+  for (auto edge : piece_graph) {
+    edge.part1 += offset;
+    edge.part2 += offset;
+    edge.plane_id += next_plane_id;
+    graph.push_back(edge);
+  }
+  next_plane_id += max_plane_id(piece_graph) + 1;
+}
+
+// Cuts part with planes fitted to the cut points around it, then recuts the
+// pieces still above config.refine_threshold while depth allows. Plane ids in
+// graph are local to the part. Returns false if the part was not split.
+bool refine_part(const Mesh &part, const vector<Vec3D> &cut_points, int depth,
+                 MeshList &pieces, PartGraph &graph) {
+  vector<Vec3D> points = cut_points_near(part, cut_points);
+  if ((int)points.size() < config.jlinkage_outlier_threshold || out_of_time())
+    return false;
+  vector<Plane> planes = fit_planes(points);
+  MeshList cut = multiclip(part, planes, graph);
+  separate_disjoint(cut, graph);
+  if (cut.size() < 2) {
+    graph.clear();
+    return false;
+  }
+
+  vector<vector<int>> children(cut.size());
+  PartGraph inner;
+  int next_plane_id = planes.size();
+  for (size_t i = 0; i < cut.size(); i++) {
+    MeshList sub;
+    PartGraph sub_graph;
+    if (depth > 1) {
+      Mesh cvx;
+      cut[i].compute_ch(cvx);
+      if (compute_h(cut[i], cvx, config.cost_rv_k, config.pcd_res) >
+              config.refine_threshold &&
+          refine_part(cut[i], points, depth - 1, sub, sub_graph)) {
+        append_pieces(pieces, inner, children[i], sub, sub_graph,
+                      next_plane_id);
+        continue;
+      }
+    }
+    children[i].push_back(pieces.size());
+    pieces.push_back(std::move(cut[i]));
+  }
+  graph = remap_part_graph(graph, children, pieces);
+  graph.insert(graph.end(), inner.begin(), inner.end());
+  return true;
+}
+
+int refine_parts(MeshList &parts, MeshList &cvxs, PartGraph &graph,
+                 const vector<Vec3D> &cut_points) {
+  if (config.refine_threshold <= 0 || config.refine_depth <= 0 ||
+      out_of_time())
+    return 0;
+  vector<double> part_h = compute_part_concavity(parts, cvxs);
+  vector<int> selected;
+  for (int i = 0; i < (int)parts.size(); i++)
+    if (part_h[i] > config.refine_threshold)
+      selected.push_back(i);
+
+  // every selected part is refined on its own, as one task
+  vector<MeshList> pieces(selected.size());
+  vector<PartGraph> piece_graphs(selected.size());
+  vector<char> split(selected.size(), 0);
+  parallel_for_seeded((int)selected.size(), [&](int k) {
+    split[k] = refine_part(parts[selected[k]], cut_points, config.refine_depth,
+                           pieces[k], piece_graphs[k]);
+  });
+
+  MeshList new_parts, new_cvxs;
+  vector<vector<int>> children(parts.size());
+  PartGraph inner;
+  int next_plane_id = max_plane_id(graph) + 1;
+  vector<int> task(parts.size(), -1);
+  for (int k = 0; k < (int)selected.size(); k++)
+    task[selected[k]] = k;
+  vector<int> first_new; // indices in new_parts still without a hull
+  int refined = 0;
+  for (int i = 0; i < (int)parts.size(); i++) {
+    int k = task[i];
+    if (k >= 0 && split[k]) {
+      size_t first = new_parts.size();
+      append_pieces(new_parts, inner, children[i], pieces[k], piece_graphs[k],
+                    next_plane_id);
+      for (size_t j = first; j < new_parts.size(); j++)
+        first_new.push_back(j);
+      new_cvxs.resize(new_parts.size());
+      refined++;
+      continue;
+    }
+    children[i].push_back(new_parts.size());
+    new_parts.push_back(std::move(parts[i]));
+    new_cvxs.push_back(std::move(cvxs[i]));
   }
+  parallel_for((int)first_new.size(), [&](int j) {
+    compute_part_ch(new_parts[first_new[j]], new_cvxs[first_new[j]]);
+  });
+
+  graph = remap_part_graph(graph, children, new_parts);
+  graph.insert(graph.end(), inner.begin(), inner.end());
+  parts = std::move(new_parts);
+  cvxs = std::move(new_cvxs);
+  count_parts(parts.size());
+  return refined;
+}
+
+vector<double> compute_part_concavity(MeshList &parts, MeshList &cvxs) {
+  vector<double> part_h(parts.size());
+  parallel_for_seeded((int)parts.size(), [&](int i) {
+    if (out_of_time())
+      return; // left at 0, which no concavity check or refinement acts on
+    part_h[i] = compute_h(parts[i], cvxs[i], config.cost_rv_k, config.pcd_res);
+  });
+  return part_h;
+}
 
+// graph comes from callers such as the bindings, and must only refer to hulls
+// in cvxs
+void check_part_graph(const char *caller, const MeshList &cvxs,
+                      const PartGraph &graph) {
+  int n = cvxs.size();
+  for (const auto &edge : graph)
+    if (edge.part1 < 0 || edge.part1 >= n || edge.part2 < 0 ||
+        edge.part2 >= n)
+      throw std::invalid_argument(std::string(caller) +
+                                  ": graph refers to a part not in cvxs");
+}
+
+double merge_hulls(MeshList &cvxs, const PartGraph &graph) {
+  check_part_graph("merge_hulls", cvxs, graph);
   // std::cout << "Merge threshold: " << config.merge_threshold << std::endl;
-  multimerge_ch(mesh, parts, cvxs, config.merge_threshold);
+  return multimerge_ch(cvxs, config.merge_threshold, graph);
+}
 
-  Mesh hull;
-  int vertex_offset = 0;
-  for (auto &cvx : cvxs) {
-    hull.vertices.insert(hull.vertices.end(), cvx.vertices.begin(),
-                         cvx.vertices.end());
-    for (auto &tri : cvx.triangles) {
-      hull.triangles.push_back({tri[0] + vertex_offset, tri[1] + vertex_offset,
-                                tri[2] + vertex_offset});
+MergeTree record_merge_tree(const MeshList &cvxs, const PartGraph &graph) {
+  check_part_graph("record_merge_tree", cvxs, graph);
+  MergeTree tree;
+  MeshList merged = cvxs;
+  multimerge_ch(merged, config.merge_threshold, graph, &tree);
+  return tree;
+}
+
+int MergeTree::num_steps(double threshold, int max_parts) const {
+  // replays the stopping rule of multimerge_ch
+  bool all_pairs = false;
+  int n = 0;
+  for (; n < (int)steps.size(); n++) {
+    bool over_cap = max_parts > 0 && num_leaves - n > max_parts;
+    if (steps[n].forced && !all_pairs) {
+      if (!over_cap)
+        break;
+      all_pairs = true;
     }
-    vertex_offset += cvx.vertices.size();
+    if (steps[n].cost > threshold && !over_cap)
+      break;
   }
+  return n;
+}
+
+MeshList MergeTree::slice(int n) const {
+  // replays the bookkeeping of multimerge_ch on the node ids
+  n = max(0, min(n, (int)steps.size()));
+  vector<int> ids(num_leaves);
+  vector<int> position(num_leaves + n);
+  for (int i = 0; i < num_leaves; i++)
+    ids[i] = position[i] = i;
+  for (int k = 0; k < n; k++) {
+    int p1 = position[steps[k].node1], p2 = position[steps[k].node2];
+    ids[p2] = num_leaves + k;
+    position[ids[p2]] = p2;
+    ids[p1] = ids.back();
+    position[ids[p1]] = p1;
+    ids.pop_back();
+  }
+  MeshList cvxs;
+  for (int id : ids)
+    cvxs.push_back(nodes[id]);
+  return cvxs;
+}
+
+MeshList MergeTree::slice_threshold(double threshold) const {
+  return slice(num_steps(threshold));
+}
+
+MeshList MergeTree::slice_parts(int num_parts) const {
+  return slice(num_steps(-INF, max(num_parts, 1)));
+}
+
+double MergeTree::max_cost(int n) const {
+  double h = 0;
+  for (int k = 0; k < n && k < (int)steps.size(); k++)
+    h = max(h, steps[k].cost);
+  return h;
+}
+
+int simplify_hulls(MeshList &cvxs) {
+  if (config.max_ch_vertex <= 0)
+    return 0;
+  vector<char> over(cvxs.size(), 0);
+  parallel_for((int)cvxs.size(), [&](int i) {
+    over[i] = !simplify_ch(cvxs[i], config.max_ch_vertex,
+                           config.ch_volume_increase);
+  });
+  return count(over.begin(), over.end(), 1);
+}
+
+void append_mesh(Mesh &hull, const Mesh &cvx) {
+  int vertex_offset = hull.vertices.size();
+  hull.vertices.insert(hull.vertices.end(), cvx.vertices.begin(),
+                       cvx.vertices.end());
+  for (auto &tri : cvx.triangles) {
+    hull.triangles.push_back({tri[0] + vertex_offset, tri[1] + vertex_offset,
+                              tri[2] + vertex_offset});
+  }
+}
+
+Mesh remesh_hulls(const MeshList &cvxs) {
+  Mesh hull;
+  for (auto &cvx : cvxs)
+    append_mesh(hull, cvx);
   manifold_preprocess(hull, config.remesh_res, config.remesh_threshold);
+  return hull;
+}
+
+void emit_isolated_hulls(MeshList &cvxs, PartGraph &graph,
+                         const HullCallback &emit) {
+  // with a part cap, isolated hulls may still be merged to meet it, and a
+  // recorded tree merges everything
+  if (!config.merge_part_graph || graph.empty() || config.max_parts > 0 ||
+      config.merge_record_tree)
+    return;
+
+  vector<char> linked(cvxs.size(), 0);
+  for (const auto &edge : graph)
+    if (edge.part1 != edge.part2)
+      linked[edge.part1] = linked[edge.part2] = 1;
+
+  // A hull without an edge is still merged with hulls closer than the
+  // threshold. Merged hulls only have vertices of the hulls they came from,
+  // so one further than that from every other hull stays out of merging.
+  parallel_for((int)cvxs.size(), [&](int i) {
+    if (linked[i])
+      return;
+    for (size_t j = 0; j < cvxs.size() && !linked[i]; j++)
+      if (j != (size_t)i &&
+          mesh_dist(cvxs[i], cvxs[j]) < config.merge_threshold)
+        linked[i] = 1;
+  });
+
+  vector<int> new_index(cvxs.size(), -1);
+  MeshList kept;
+  for (size_t i = 0; i < cvxs.size(); i++) {
+    if (linked[i]) {
+      new_index[i] = kept.size();
+      kept.push_back(std::move(cvxs[i]));
+    } else {
+      emit(cvxs[i]);
+    }
+  }
+
+  PartGraph new_graph;
+  for (auto edge : graph) {
+    if (new_index[edge.part1] < 0 || new_index[edge.part2] < 0)
+      continue;
+    edge.part1 = new_index[edge.part1];
+    edge.part2 = new_index[edge.part2];
+    new_graph.push_back(edge);
+  }
+  graph = std::move(new_graph);
+  cvxs = std::move(kept);
+}
+
+double compute_concavity(Mesh &mesh, Mesh &hull) {
+  return compute_h(mesh, hull, config.cost_rv_k, config.pcd_res);
+}
+
+// streams the final hulls to emit instead of returning them if emit is set
+ProcessResult run_process(Mesh &mesh, vector<Vec3D> &cut_points,
+                          const HullCallback &emit,
+                          const std::string &stats_file,
+                          const std::string &metrics_file) {
+  // cout << cut_points.size() << " cut points provided." << endl;
+  ProcessResult result;
+  vector<StageStats> &stages = result.stages;
+  MetricsCounters counters;
+  MetricsScope scope(&counters);
+  optional<Deadline> deadline;
+  if (config.process_time_budget > 0)
+    deadline.emplace(config.process_time_budget);
+  DeadlineScope deadline_scope(deadline ? &*deadline : nullptr);
+  result.metrics.input_vertices = mesh.vertices.size();
+  result.metrics.input_triangles = mesh.triangles.size();
+  result.metrics.cut_points = cut_points.size();
+
+  StageTimer timer;
+  normalize_input(mesh, cut_points);
+  timer.finish(stages, "normalize", mesh.vertices.size());
+
+  // plane fitting may use half of the budget, so that clipping and merging
+  // get to run
+  timer = StageTimer();
+  vector<Plane> planes;
+  {
+    optional<Deadline> fit_deadline;
+    if (deadline)
+      fit_deadline = deadline->share(0.5);
+    DeadlineScope fit_scope(fit_deadline ? &*fit_deadline : nullptr);
+    planes = fit_planes(cut_points);
+  }
+  timer.finish(stages, "fit_planes", planes.size());
+  result.metrics.planes = planes.size();
+
+  timer = StageTimer();
+  PartGraph graph;
+  MeshList parts = multiclip(mesh, planes, graph);
+  timer.finish(stages, "clip", parts.size());
+
+  timer = StageTimer();
+  separate_disjoint(parts, graph);
+  timer.finish(stages, "separate", parts.size());
+  count_parts(parts.size());
+
+  timer = StageTimer();
+  MeshList cvxs = compute_hulls(parts);
+  timer.finish(stages, "hulls", cvxs.size());
+
+  if (config.refine_threshold > 0) {
+    timer = StageTimer();
+    refine_parts(parts, cvxs, graph, cut_points);
+    timer.finish(stages, "refine", parts.size());
+  }
+
+  // The full check cannot stop early and may take longer than the rest of
+  // the run, so under a budget the fast estimate is given instead.
+  ConcavityMode concavity_mode = config.process_concavity;
+  if (deadline && concavity_mode == CONCAVITY_FULL)
+    concavity_mode = CONCAVITY_FAST;
+
+  vector<double> part_h;
+  if (concavity_mode == CONCAVITY_FAST) {
+    timer = StageTimer();
+    part_h = compute_part_concavity(parts, cvxs);
+    timer.finish(stages, "part_concavity", part_h.size());
+  }
+
+  // in streaming mode each hull is passed on as soon as it is final, and only
+  // the union needed by the full concavity check is kept
+  bool streaming = (bool)emit;
+  Mesh hull_union;
+  long n_hulls = 0;
+  auto finalize = [&](const Mesh &cvx) {
+    Mesh simplified = cvx;
+    if (config.max_ch_vertex > 0 &&
+        !simplify_ch(simplified, config.max_ch_vertex,
+                     config.ch_volume_increase))
+      result.metrics.hulls_over_vertex_limit++;
+    result.metrics.max_hull_vertices =
+        max(result.metrics.max_hull_vertices, (long)simplified.vertices.size());
+    if (concavity_mode == CONCAVITY_FULL)
+      append_mesh(hull_union, simplified);
+    emit(simplified);
+    n_hulls++;
+  };
+  if (streaming) {
+    MeshList().swap(parts);
+    timer = StageTimer();
+    emit_isolated_hulls(cvxs, graph, finalize);
+    timer.finish(stages, "emit_isolated", n_hulls);
+  }
+
+  timer = StageTimer();
+  double merge_h;
+  if (config.merge_record_tree) {
+    result.merge_tree = record_merge_tree(cvxs, graph);
+    int n = result.merge_tree.num_steps(config.merge_threshold,
+                                        config.max_parts);
+    cvxs = result.merge_tree.slice(n);
+    merge_h = result.merge_tree.max_cost(n);
+  } else {
+    merge_h = merge_hulls(cvxs, graph);
+  }
+  timer.finish(stages, "merge", cvxs.size());
+
+  if (streaming) {
+    timer = StageTimer();
+    for (auto &cvx : cvxs)
+      finalize(cvx);
+    MeshList().swap(cvxs);
+    timer.finish(stages, "emit", n_hulls);
+  } else {
+    timer = StageTimer();
+    result.metrics.hulls_over_vertex_limit = simplify_hulls(cvxs);
+    for (auto &cvx : cvxs)
+      result.metrics.max_hull_vertices =
+          max(result.metrics.max_hull_vertices, (long)cvx.vertices.size());
+    timer.finish(stages, "simplify", cvxs.size());
+    n_hulls = cvxs.size();
+  }
+
+  double h = numeric_limits<double>::quiet_NaN();
+  timer = StageTimer();
+  if (concavity_mode != config.process_concavity) {
+    // both stages are recorded as skipped for the budget
+    count_event(&MetricsCounters::budget_stops);
+    timer.finish(stages, "remesh", 0);
+    timer.finish(stages, "concavity", 0);
+  }
+  if (concavity_mode == CONCAVITY_FULL) {
+    Mesh hull;
+    if (streaming) {
+      hull = std::move(hull_union);
+      manifold_preprocess(hull, config.remesh_res, config.remesh_threshold);
+    } else {
+      hull = remesh_hulls(cvxs);
+    }
+    timer.finish(stages, "remesh", hull.triangles.size());
+
+    timer = StageTimer();
+    h = compute_concavity(mesh, hull);
+    timer.finish(stages, "concavity", 1);
+  } else if (concavity_mode == CONCAVITY_FAST) {
+    // the worst part against its own hull, or the worst merge (the radius
+    // of the volume it added, weighted as in compute_h), whichever is larger
+    h = merge_h * config.cost_rv_k;
+    for (double ph : part_h)
+      h = max(h, ph);
+  }
 
-  double h = compute_h(mesh, hull, config.cost_rv_k, config.pcd_res);
-  cout << "Final concavity: " << h << endl;
-  cout << "Number of parts: " << cvxs.size() << endl;
+  if (show_progress()) {
+    if (!std::isnan(h))
+      cout << "Final concavity: " << h << endl;
+    cout << "Number of parts: " << n_hulls << endl;
+  }
 
   if (!stats_file.empty())
-    write_stats(stats_file, h, cvxs.size());
+    write_stats(stats_file, h, n_hulls);
+
+  result.parts = std::move(parts);
+  result.cvxs = std::move(cvxs);
+  result.concavity = h;
+  result.metrics.output_hulls = n_hulls;
+  counters.add_to(result.metrics);
+  result.truncated = result.metrics.budget_stops > 0;
+  if (!metrics_file.empty())
+    write_metrics(metrics_file, result);
+  return result;
+}
+
+ProcessResult process_timed(Mesh mesh, vector<Vec3D> cut_points,
+                            std::string stats_file, std::string metrics_file) {
+  return run_process(mesh, cut_points, nullptr, stats_file, metrics_file);
+}
+
+ProcessResult process_stream(Mesh mesh, vector<Vec3D> cut_points,
+                             const HullCallback &emit, std::string stats_file,
+                             std::string metrics_file) {
+  if (!emit)
+    throw std::invalid_argument("process_stream: no callback given");
+  return run_process(mesh, cut_points, emit, stats_file, metrics_file);
+}
+
+HullCallback obj_writer(std::string directory) {
+  auto index = std::make_shared<int>(0);
+  return [directory, index](const Mesh &cvx) {
+    write_obj(directory + "/hull_" + to_string((*index)++) + ".obj", cvx);
+  };
+}
+
+vector<BatchResult> process_batch(const MeshList &meshes,
+                                  const vector<vector<Vec3D>> &cut_points,
+                                  std::string stats_file,
+                                  std::string metrics_file) {
+  if (meshes.size() != cut_points.size())
+    throw std::invalid_argument(
+        "process_batch: meshes and cut_points differ in length");
+
+  vector<BatchResult> results(meshes.size());
+  parallel_for_seeded((int)meshes.size(), [&](int i) {
+    BatchResult &res = results[i];
+    if (meshes[i].vertices.empty() || meshes[i].triangles.empty()) {
+      res.status = PROCESS_EMPTY_MESH;
+      return;
+    }
+    try {
+      res.result = process_timed(meshes[i], cut_points[i]);
+    } catch (const std::exception &e) {
+      res.status = PROCESS_FAILED;
+      res.error = e.what();
+    } catch (...) {
+      res.status = PROCESS_FAILED;
+      res.error = "unknown error";
+    }
+  });
+
+  for (auto &res : results) {
+    if (res.status != PROCESS_OK)
+      continue;
+    if (!stats_file.empty())
+      write_stats(stats_file, res.result.concavity, res.result.cvxs.size());
+    if (!metrics_file.empty())
+      write_metrics(metrics_file, res.result);
+  }
+  return results;
+}
+
+MeshList process(Mesh mesh, vector<Vec3D> cut_points, std::string stats_file) {
+  ProcessResult result = process_timed(mesh, cut_points, stats_file);
 
   // cvxs.push_back(hull);
 
   if (config.process_output_parts)
-    return parts;
-  return cvxs;
+    return result.parts;
+  return result.cvxs;
 }
 
 } // namespace neural_acd
\ No newline at end of file
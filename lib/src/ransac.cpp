@@ -0,0 +1,127 @@
+#include <Eigen/Dense>
+#include <algorithm>
+#include <budget.hpp>
+#include <cmath>
+#include <cost.hpp>
+#include <iostream>
+#include <kdtree.hpp>
+#include <parallel.hpp>
+#include <random>
+#include <ransac.hpp>
+
+using namespace std;
+
+namespace neural_acd {
+Ransac::Ransac(double threshold_, int min_support_, int max_iterations_,
+               double normal_angle_, int num_neighbours_, double confidence_)
+    : threshold(threshold_), min_support(max(min_support_, 3)),
+      max_iterations(max_iterations_),
+      min_normal_dot(cos(normal_angle_ * Pi / 180)),
+      num_neighbours(num_neighbours_), confidence(confidence_) {}
+
+void Ransac::set_points(const vector<Vec3D> &pts) {
+  points = pts;
+  estimate_normals();
+}
+
+// normal of the best fitting plane through the given points, and its offset
+void fit_plane(const vector<Vec3D> &points, const vector<int> &idx, Vec3D &n,
+               double &d) {
+  Vec3D centroid = {0.0, 0.0, 0.0};
+  for (int i : idx)
+    centroid = centroid + points[i];
+  centroid = centroid / (double)idx.size();
+
+  Eigen::Matrix3d cov = Eigen::Matrix3d::Zero();
+  for (int i : idx) {
+    Eigen::Vector3d v(points[i][0] - centroid[0], points[i][1] - centroid[1],
+                      points[i][2] - centroid[2]);
+    cov += v * v.transpose();
+  }
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(cov);
+  Eigen::Vector3d normal = solver.eigenvectors().col(0); // smallest
+  n = {normal(0), normal(1), normal(2)};
+  d = -dot(n, centroid);
+}
+
+void Ransac::estimate_normals() {
+  int N = points.size();
+  normals.assign(N, {0.0, 0.0, 1.0});
+  if (N < 3)
+    return;
+  PointCloud<double> cloud;
+  vec2pc(cloud, points);
+  KDTree3D tree(3, cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10));
+  tree.buildIndex();
+
+  size_t k = min(N, num_neighbours + 1);
+  vector<size_t> index(k);
+  vector<double> dist(k);
+  vector<int> neighbours(k);
+  for (int i = 0; i < N; ++i) {
+    size_t found = tree.knnSearch(&points[i][0], k, &index[0], &dist[0]);
+    neighbours.assign(index.begin(), index.begin() + found);
+    double d;
+    fit_plane(points, neighbours, normals[i], d);
+  }
+}
+
+vector<int> Ransac::inliers(const vector<int> &candidates, const Vec3D &n,
+                            double d) const {
+  vector<int> in;
+  for (int i : candidates)
+    if (abs(dot(points[i], n) + d) < threshold &&
+        abs(dot(normals[i], n)) >= min_normal_dot)
+      in.push_back(i);
+  return in;
+}
+
+vector<Plane> Ransac::get_best_planes() {
+  vector<int> remaining(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+    remaining[i] = i;
+
+  vector<Plane> planes;
+  while ((int)remaining.size() >= min_support && !out_of_time()) {
+    uniform_int_distribution<> pick(0, remaining.size() - 1);
+    vector<int> best;
+    int needed = max_iterations;
+    for (int it = 0; it < needed; ++it) {
+      int s = remaining[pick(random_engine)];
+      vector<int> in =
+          inliers(remaining, normals[s], -dot(normals[s], points[s]));
+      if (in.size() <= best.size())
+        continue;
+      best.swap(in);
+      // with one-point samples, k draws all miss a plane holding a fraction
+      // w of the points with probability (1 - w)^k
+      double w = (double)best.size() / remaining.size();
+      if (w >= 1)
+        break;
+      needed = min(max_iterations,
+                   (int)ceil(log(1 - confidence) / log(1 - w)));
+    }
+    if ((int)best.size() < min_support)
+      break;
+
+    // refit to the inliers, which then leave the pool with those of the
+    // refitted plane
+    Vec3D n;
+    double d;
+    fit_plane(points, best, n, d);
+    planes.push_back(Plane(n[0], n[1], n[2], d));
+    vector<int> refit = inliers(remaining, n, d);
+    vector<char> taken(points.size(), 0);
+    for (int i : best)
+      taken[i] = 1;
+    for (int i : refit)
+      taken[i] = 1;
+    remaining.erase(remove_if(remaining.begin(), remaining.end(),
+                              [&](int i) { return taken[i]; }),
+                    remaining.end());
+  }
+  if (show_progress())
+    cout << "Found " << planes.size() << " planes" << endl;
+  return planes;
+}
+} // namespace neural_acd
\ No newline at end of file
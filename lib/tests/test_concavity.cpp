@@ -0,0 +1,43 @@
+#include <config.hpp>
+#include <core.hpp>
+#include <generate.hpp>
+#include <iostream>
+#include <process.hpp>
+#include <vector>
+
+using namespace std;
+using namespace neural_acd;
+
+// Runs generated structures with the full and the fast concavity check and
+// fails if the fast estimate is not within an order of magnitude of the full
+// one, give or take a small absolute slack for nearly convex results.
+
+double concavity(Mesh mesh, ConcavityMode mode) {
+  config.process_concavity = mode;
+  set_seed(42);
+  // every fourth cut point, to keep plane fitting short
+  vector<Vec3D> cut_points;
+  for (size_t i = 0; i < mesh.cut_verts.size(); i += 4)
+    cut_points.push_back(mesh.cut_verts[i]);
+  return process_timed(mesh, cut_points).concavity;
+}
+
+int main() {
+  // settings of config/config.yaml, with fewer hypotheses to keep it short
+  config.jlinkage_sigma = 0.1;
+  config.jlinkage_num_samples = 2000;
+  config.merge_threshold = 0.04;
+  set_seed(42);
+  vector<Mesh> meshes = {generate_cuboid_structure(3),
+                         generate_cuboid_structure(6),
+                         generate_sphere_structure(3)};
+  int failures = 0;
+  for (size_t i = 0; i < meshes.size(); i++) {
+    double full = concavity(meshes[i], CONCAVITY_FULL);
+    double fast = concavity(meshes[i], CONCAVITY_FAST);
+    cout << "mesh " << i << ": full " << full << ", fast " << fast << endl;
+    if (!(fast <= 10 * full + 0.01 && full <= 10 * fast + 0.01))
+      failures++;
+  }
+  return failures ? 1 : 0;
+}
\ No newline at end of file
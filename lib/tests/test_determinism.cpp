@@ -0,0 +1,92 @@
+#include <config.hpp>
+#include <core.hpp>
+#include <cstdint>
+#include <generate.hpp>
+#include <iostream>
+#include <jlinkage.hpp>
+#include <process.hpp>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace neural_acd;
+
+// Runs every seeded step of the pipeline with 1, 2 and all hardware threads
+// and fails if any of them gives a different result.
+
+using Hashes = vector<pair<string, uint64_t>>;
+
+// plane coefficients as vertices, so that decomposition_hash covers them
+uint64_t planes_hash(const vector<Plane> &planes) {
+  Mesh mesh;
+  for (auto &p : planes) {
+    mesh.vertices.push_back({p.a, p.b, p.c});
+    mesh.vertices.push_back({p.d, 0, 0});
+  }
+  return decomposition_hash({mesh});
+}
+
+uint64_t result_hash(const ProcessResult &result) {
+  Mesh concavity;
+  concavity.vertices.push_back({result.concavity, 0, 0});
+  MeshList meshes = result.cvxs;
+  meshes.push_back(concavity);
+  return decomposition_hash(meshes);
+}
+
+Hashes run(int threads) {
+  config.num_threads = threads;
+  set_seed(42);
+  Hashes hashes;
+
+  Mesh cuboids = generate_cuboid_structure(6);
+  Mesh spheres = generate_sphere_structure(3);
+  hashes.push_back({"generate", decomposition_hash({cuboids, spheres})});
+
+  // every fourth cut point, to keep plane fitting short
+  vector<Vec3D> cut_points;
+  for (size_t i = 0; i < cuboids.cut_verts.size(); i += 4)
+    cut_points.push_back(cuboids.cut_verts[i]);
+
+  JLinkage jlinkage(config.jlinkage_sigma, config.jlinkage_num_samples,
+                    config.jlinkage_threshold,
+                    config.jlinkage_outlier_threshold);
+  jlinkage.set_points(cut_points);
+  hashes.push_back({"jlinkage", planes_hash(jlinkage.get_best_planes())});
+  hashes.push_back({"fit_planes", planes_hash(fit_planes(cut_points))});
+
+  hashes.push_back({"process_timed",
+                    result_hash(process_timed(cuboids, cut_points))});
+
+  vector<BatchResult> batch =
+      process_batch({cuboids, spheres}, {cut_points, spheres.cut_verts});
+  for (size_t i = 0; i < batch.size(); i++)
+    hashes.push_back({"process_batch[" + to_string(i) + "]",
+                      result_hash(batch[i].result)});
+  return hashes;
+}
+
+int main() {
+  // settings of config/config.yaml, with fewer hypotheses to keep it short
+  config.jlinkage_sigma = 0.1;
+  config.jlinkage_num_samples = 2000;
+  config.merge_threshold = 0.04;
+  int hardware = (int)thread::hardware_concurrency();
+  Hashes expected = run(1);
+  int failures = 0;
+  for (int threads : {2, hardware > 0 ? hardware : 1}) {
+    Hashes hashes = run(threads);
+    for (size_t i = 0; i < expected.size(); i++) {
+      if (hashes[i].second == expected[i].second)
+        continue;
+      cerr << expected[i].first << " differs with " << threads
+           << " threads" << endl;
+      failures++;
+    }
+  }
+  if (failures == 0)
+    cout << "same results at every thread count" << endl;
+  return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include <config.hpp>
+#include <core.hpp>
+#include <cstdlib>
+#include <generate.hpp>
+#include <iostream>
+#include <jlinkage.hpp>
+#include <vector>
+
+using namespace std;
+using namespace neural_acd;
+
+// Fits the cut planes of a generated structure with exact and LSH
+// clustering and fails if LSH finds a clearly different number of planes.
+
+int count_planes(const vector<Vec3D> &points, int lsh_bands) {
+  set_seed(42);
+  JLinkage jlinkage(0.1, 2000, config.jlinkage_threshold,
+                    config.jlinkage_outlier_threshold, 0, lsh_bands,
+                    config.jlinkage_lsh_rows);
+  jlinkage.set_points(points);
+  return jlinkage.get_best_planes().size();
+}
+
+int main() {
+  set_seed(42);
+  Mesh cuboids = generate_cuboid_structure(6);
+  // every fourth cut point, to keep plane fitting short
+  vector<Vec3D> cut_points;
+  for (size_t i = 0; i < cuboids.cut_verts.size(); i += 4)
+    cut_points.push_back(cuboids.cut_verts[i]);
+
+  int exact = count_planes(cut_points, 0);
+  int failures = 0;
+  for (int bands : {8, 16, 32}) {
+    int planes = count_planes(cut_points, bands);
+    cout << bands << " bands: " << planes << " planes, exact " << exact
+         << endl;
+    if (abs(planes - exact) > max(2, exact / 2))
+      failures++;
+  }
+  return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -52,11 +52,34 @@ def load_lib_config(config):
     lib_config.cost_rv_k = config.lib.cost_rv_k
 
     lib_config.merge_threshold = config.lib.merge_threshold
+    lib_config.merge_part_graph = config.lib.merge.part_graph
+    lib_config.merge_cache_size = config.lib.merge.cache_size
+    lib_config.max_parts = config.lib.merge.max_parts
+    lib_config.merge_record_tree = config.lib.merge.record_tree
 
+    lib_config.max_ch_vertex = config.lib.hull.max_vertex
+    lib_config.ch_volume_increase = config.lib.hull.volume_increase
+
+    lib_config.plane_fit = getattr(lib_neural_acd.PlaneFitMode, config.lib.plane_fit.upper())
     lib_config.jlinkage_sigma = config.lib.jlinkage.sigma
     lib_config.jlinkage_num_samples = config.lib.jlinkage.num_samples
     lib_config.jlinkage_threshold = config.lib.jlinkage.threshold
     lib_config.jlinkage_outlier_threshold = config.lib.jlinkage.outlier_threshold
+    lib_config.jlinkage_voxel_ratio = config.lib.jlinkage.voxel_ratio
+    lib_config.jlinkage_partition_ratio = config.lib.jlinkage.partition_ratio
+    lib_config.jlinkage_lsh_bands = config.lib.jlinkage.lsh_bands
+    lib_config.jlinkage_lsh_rows = config.lib.jlinkage.lsh_rows
+    lib_config.ransac_max_iterations = config.lib.ransac.max_iterations
+    lib_config.ransac_normal_angle = config.lib.ransac.normal_angle
+    lib_config.ransac_neighbours = config.lib.ransac.neighbours
+
+    lib_config.refine_threshold = config.lib.refine.threshold
+    lib_config.refine_depth = config.lib.refine.depth
+
+    lib_config.process_concavity = getattr(lib_neural_acd.ConcavityMode, config.lib.process.concavity.upper())
+    lib_config.process_time_budget = config.lib.process.time_budget
+
+    lib_config.num_threads = config.lib.num_threads
 
 def load_config(*yaml_files, cli_args=[]):
     yaml_confs = [OmegaConf.load(f) for f in yaml_files]